@@ -0,0 +1,246 @@
+
+class BandMatrix {
+
+public:
+
+    /* Number of rows and columns of the matrix */
+    int K;
+
+    /* Number of diagonals below the main diagonal containing non-zero elements.
+    Being the matrix symmetric, it is also the number of non-zero diagonals
+    above the main diagonal */
+    int bandwidth;
+
+    /* Elements of the main diagonal and of the diagonals below it, stored
+    diagonal by diagonal in a (bandwidth+1)*K block. Element (i,j), with
+    0 <= i-j <= bandwidth, is saved at position (i-j)*K+j. After factorize() the
+    main diagonal contains D and the other diagonals contain L */
+    vector<double> elements;
+
+    ////////////////////////////////////////////////////////////////////////////
+
+    /* Sets the dimensions of the matrix and fills the band with zeros */
+    void resize(int K, int bandwidth);
+
+    /* Returns element (i,j) of the matrix. |i-j| must not exceed bandwidth */
+    double& operator()(int i, int j);
+
+    /* Returns element (i,j) of the matrix. |i-j| must not exceed bandwidth */
+    double operator()(int i, int j) const;
+
+    /* Sets the matrix equal to A + lambda*B. A and B must have the same
+    dimensions as the matrix */
+    void sum(const BandMatrix& A, double lambda, const BandMatrix& B);
+
+    /* Calculates the square root of the sum of squares of the elements of the
+    matrix, including those above the main diagonal */
+    double norm() const;
+
+    /* Calculates the LDLT decomposition of the matrix, where L is lower
+    triangular with ones on the main diagonal and D is diagonal. Saves D and L
+    in place of the elements of the matrix */
+    void factorize();
+
+    /* Solves L*D*LT*x = b, where L and D are obtained from factorize(). b is
+    replaced by x */
+    void solve(vector<double>& b) const;
+
+    /* Solves L*x = b, where L is obtained from factorize(). b is replaced by x
+    */
+    void forwardSubstitution(vector<double>& b) const;
+
+    /* Solves LT*x = b, where L is obtained from factorize(). b is replaced by x
+    */
+    void backwardSubstitution(vector<double>& b) const;
+
+    /* Calculates the elements of the inverse of the matrix that fall inside the
+    band, without forming the whole inverse, using the Takahashi recurrences on
+    the L and D matrices obtained from factorize(). The cost is proportional to
+    K*bandwidth*bandwidth */
+    void selectedInverse(BandMatrix& inverse) const;
+
+    /* Calculates the trace of the product of the matrix and B, where B has the
+    same dimensions as the matrix. Only the elements inside the band are used */
+    double traceOfProduct(const BandMatrix& B) const;
+
+    /* Memory reserved for the elements, in bytes. It is kept when the matrix
+    is resized to a smaller or equal number of elements */
+    size_t reservedBytes() const;
+
+};
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+
+
+void BandMatrix::resize(int k, int Bandwidth) {
+
+    K = k;
+    bandwidth = min(Bandwidth, max(K-1,0));
+
+    elements.assign((bandwidth+1)*K, 0);
+
+}
+
+
+
+double& BandMatrix::operator()(int i, int j) {
+
+    return i >= j ? elements[(i-j)*K+j] : elements[(j-i)*K+i];
+
+}
+
+
+
+double BandMatrix::operator()(int i, int j) const {
+
+    return i >= j ? elements[(i-j)*K+j] : elements[(j-i)*K+i];
+
+}
+
+
+
+void BandMatrix::sum(const BandMatrix& A, double lambda, const BandMatrix& B) {
+
+    for (int i=0; i<(int)elements.size(); ++i)
+        elements[i] = A.elements[i] + lambda * B.elements[i];
+
+}
+
+
+
+double BandMatrix::norm() const {
+
+    double sumOfSquares = 0;
+    for (int j=0; j<K; ++j)
+        sumOfSquares += elements[j] * elements[j];
+    for (int i=K; i<(int)elements.size(); ++i)
+        sumOfSquares += 2. * elements[i] * elements[i];
+
+    return sqrt(sumOfSquares);
+
+}
+
+
+
+void BandMatrix::factorize() {
+
+    // For each column j, D[j] = M[j][j] - sum(L[j][k]^2 * D[k]) and
+    // L[i][j] = (M[i][j] - sum(L[i][k] * L[j][k] * D[k])) / D[j], where k spans
+    // the columns preceding j that fall inside the band of both rows
+    double* D = elements.data();
+    for (int j=0; j<K; ++j) {
+
+        for (int k=max(0,j-bandwidth); k<j; ++k) {
+            double Ljk = elements[(j-k)*K+k];
+            D[j] -= Ljk * Ljk * D[k];
+        }
+
+        int last = min(K-1,j+bandwidth);
+        for (int i=j+1; i<=last; ++i) {
+            double& Lij = elements[(i-j)*K+j];
+            for (int k=max(0,i-bandwidth); k<j; ++k)
+                Lij -= elements[(i-k)*K+k] * elements[(j-k)*K+k] * D[k];
+            Lij /= D[j];
+        }
+
+    }
+
+}
+
+
+
+void BandMatrix::solve(vector<double>& b) const {
+
+    // L*z = b
+    forwardSubstitution(b);
+
+    // D*w = z
+    for (int i=0; i<K; ++i)
+        b[i] /= elements[i];
+
+    // LT*x = w
+    backwardSubstitution(b);
+
+}
+
+
+
+void BandMatrix::forwardSubstitution(vector<double>& b) const {
+
+    for (int i=1; i<K; ++i)
+        for (int k=max(0,i-bandwidth); k<i; ++k)
+            b[i] -= elements[(i-k)*K+k] * b[k];
+
+}
+
+
+
+void BandMatrix::backwardSubstitution(vector<double>& b) const {
+
+    for (int i=K-2; i>-1; --i) {
+        int last = min(K-1,i+bandwidth);
+        for (int k=i+1; k<=last; ++k)
+            b[i] -= elements[(k-i)*K+i] * b[k];
+    }
+
+}
+
+
+
+void BandMatrix::selectedInverse(BandMatrix& inverse) const {
+
+    inverse.resize(K,bandwidth);
+
+    // Being Z the inverse, Z = D^-1*L^-1 + (I-LT)*Z. For c >= j this gives
+    // Z[c][j] = -sum(L[k][j] * Z[k][c]) and Z[j][j] = 1/D[j] - sum(L[k][j] *
+    // Z[k][j]), with j < k <= j+bandwidth. Proceeding from the last column, the
+    // elements of Z required on the right hand side are always already known
+    // and inside the band
+    for (int j=K-1; j>-1; --j) {
+
+        int last = min(K-1,j+bandwidth);
+
+        for (int c=last; c>j; --c) {
+            double Zcj = 0;
+            for (int k=j+1; k<=last; ++k)
+                Zcj -= elements[(k-j)*K+j] * inverse(k,c);
+            inverse(c,j) = Zcj;
+        }
+
+        double Zjj = 1. / elements[j];
+        for (int k=j+1; k<=last; ++k)
+            Zjj -= elements[(k-j)*K+j] * inverse(k,j);
+        inverse(j,j) = Zjj;
+
+    }
+
+}
+
+
+
+double BandMatrix::traceOfProduct(const BandMatrix& B) const {
+
+    // Both matrices are symmetric, so trace(A*B) is the sum of the products of
+    // the corresponding elements
+    double trace = 0;
+    for (int j=0; j<K; ++j)
+        trace += elements[j] * B.elements[j];
+    for (int i=K; i<(int)elements.size(); ++i)
+        trace += 2. * elements[i] * B.elements[i];
+
+    return trace;
+
+}
+
+
+
+size_t BandMatrix::reservedBytes() const {
+
+    return elements.capacity()*sizeof(double);
+
+}
@@ -1,81 +1,203 @@
-
 #include "Settings.h"
 
-class BasisFunction {
+/* Highest degree for which the cardinal B-splines are tabulated */
+const int maximumCardinalDegree = 6;
+
+/* Polynomials of the cardinal B-splines of degree g = 0, ..., 6, defined on
+the knots 0, 1, ..., g+1. Polynomial p, defined between knots p and p+1, is
+written in terms of s = x-p, and the coefficient of s^a multiplied by g! is
+saved at position [g][p][a] */
+const double cardinalBSplines[maximumCardinalDegree+1][maximumCardinalDegree+1]
+                             [maximumCardinalDegree+1] = {
+    {{1}},
+    {{0, 1},
+     {1, -1}},
+    {{0, 0, 1},
+     {1, 2, -2},
+     {1, -2, 1}},
+    {{0, 0, 0, 1},
+     {1, 3, 3, -3},
+     {4, 0, -6, 3},
+     {1, -3, 3, -1}},
+    {{0, 0, 0, 0, 1},
+     {1, 4, 6, 4, -4},
+     {11, 12, -6, -12, 6},
+     {11, -12, -6, 12, -4},
+     {1, -4, 6, -4, 1}},
+    {{0, 0, 0, 0, 0, 1},
+     {1, 5, 10, 10, 5, -5},
+     {26, 50, 20, -20, -20, 10},
+     {66, 0, -60, 0, 30, -10},
+     {26, -50, 20, 20, -20, 5},
+     {1, -5, 10, -10, 5, -1}},
+    {{0, 0, 0, 0, 0, 0, 1},
+     {1, 6, 15, 20, 15, 6, -6},
+     {57, 150, 135, 20, -45, -30, 15},
+     {302, 240, -150, -160, 30, 60, -20},
+     {302, -240, -150, 160, 30, -60, 15},
+     {57, -150, 135, -20, -45, 30, -6},
+     {1, -6, 15, -20, 15, -6, 1}}
+};
+
+
+
+/* Basis functions of a spline. The coefficients of the polynomials of all the
+basis functions are calculated together with the Cox-de Boor recurrence, knot
+interval by knot interval, and saved in flat vectors. If the knots are equally
+spaced every basis function is a shifted and scaled copy of the cardinal
+B-spline, and the tabulated polynomials are used instead */
+class BasisFunctions {
 
 public:
 
-    /* Coefficients of the basis function */
-    vector<vector<double>> coeffD0;
+    /* Degree of the basis functions */
+    int g;
+
+    /* Order of the basis functions */
+    int m;
+
+    /* Number of basis functions */
+    int K;
+
+    /* Knots of the spline, including non-real ones */
+    vector<double> knots;
+
+    /* True if the knots are equally spaced and g does not exceed
+    maximumCardinalDegree */
+    bool uniform;
+
+    /* Mean distance between consecutive knots */
+    double spacing;
 
-    /* Coefficients of the first derivative of the basis function */
-    vector<vector<double>> coeffD1;
+    /* Coefficients of the basis functions. Basis function j is made of m
+    polynomials, polynomial p being defined between knots[j+p] and
+    knots[j+p+1]. The coefficient of x^a of polynomial p of basis function j is
+    saved at position (j*m+p)*m+a */
+    vector<double> coefficientsD0;
 
-    /* Coefficients of the second derivative of the basis function */
-    vector<vector<double>> coeffD2;
+    /* Coefficients of the first derivatives of the basis functions, saved as
+    coefficientsD0 */
+    vector<double> coefficientsD1;
+
+    /* Coefficients of the second derivatives of the basis functions, saved as
+    coefficientsD0 */
+    vector<double> coefficientsD2;
 
     ////////////////////////////////////////////////////////////////////////////
 
-    /* Calculates the coefficients of the basis function, and calculates the
-    coefficients of its first and second derivative */
-    void calculateCoefficients(int indexFirstKnot, const vector<double>& knots);
+    /* Calculates the coefficients of the basis functions of degree g defined
+    on knotsForCalculations, and the coefficients of their first and second
+    derivatives */
+    void calculateCoefficients(const vector<double>& knotsForCalculations,
+                               int degree);
+
+    /* Returns the m coefficients of polynomial p of basis function j */
+    const double* coeffD0(int j, int p) const;
+
+    /* Returns the m coefficients of the first derivative of polynomial p of
+    basis function j */
+    const double* coeffD1(int j, int p) const;
 
-    /* Calculates the value of the basis function at position x on the x-axis */
-    double D0(double x);
+    /* Returns the m coefficients of the second derivative of polynomial p of
+    basis function j */
+    const double* coeffD2(int j, int p) const;
 
-    /* Calculates the value of the first derivative of the basis function at
+    /* Calculates the value of basis function j at position x on the x-axis */
+    double D0(int j, double x) const;
+
+    /* Calculates the value of the first derivative of basis function j at
     position x on the x-axis */
-    double D1(double x);
+    double D1(int j, double x) const;
 
-    /* Calculates the integral of the product of the second derivatives of the
-    current BasisFunction and basisFunction. The basis functions must belong to
-    the same spline */
-    double integralOfProductD2(const BasisFunction& basisFunction);
+    /* Calculates the value of the second derivative of basis function j at
+    position x on the x-axis */
+    double D2(int j, double x) const;
+
+    /* Calculates the matrix of the integrals between the real knots of the
+    products of the second derivatives of the basis functions. The integrals
+    are calculated knot interval by knot interval with Gauss-Legendre
+    quadrature, which is exact for these polynomials. The second derivatives
+    at the nodes are calculated with secondDerivativesAt */
+    void calculatePenalty(BandMatrix& R);
+
+    /* Calculates the difference penalty DTD of the P-splines, where D is the
+    matrix of the differences of the given order between the coefficients of
+    consecutive basis functions. The bandwidth of the result is the largest
+    between g and order */
+    void calculateDifferencePenalty(int order, BandMatrix& R);
+
+    /* Memory reserved by the vectors, in bytes. The vectors keep it when the
+    basis functions are calculated again */
+    size_t reservedBytes() const;
 
 ////////////////////////////////////////////////////////////////////////////////
 
 private:
 
-    /* Knots of the basis function, including non-real ones */
-    vector<double> knotsAll;
+    /* Polynomials of the basis functions which are non-zero inside the knot
+    interval being considered, m coefficients each */
+    vector<double> level;
+
+    /* Terms of the Cox-de Boor recurrence */
+    vector<double> alpha;
+    vector<double> beta;
 
-    /* Knots of the basis function, excluding non-real ones */
-    vector<double> knotsReal;
+    /* Nodes and weights of the Gauss-Legendre quadrature on [-1,1] */
+    vector<double> gaussNodes;
+    vector<double> gaussWeights;
 
-    /* Index of the leftmost knot of the basis function in the knotsAll vector
-    */
-    int j;
+    /* Second derivatives of the m basis functions which are non-zero inside
+    a knot interval, at a node of the quadrature */
+    vector<double> valuesD2;
 
-    /* Index of the first real knot in the knotsAll vector */
-    int indexOfFirstRealKnot;
+    /* Distances of a node of the quadrature from the knots on its left and on
+    its right, used by secondDerivativesAt */
+    vector<double> leftDistances;
+    vector<double> rightDistances;
 
-    /* Maximum height the basis function might reach, if it were the leftmost or
-    rightmost basis function of the spline */
-    double maxHeight;
+    /* Integrals of the products of the second derivatives of the polynomials
+    of the cardinal B-spline, m*m elements */
+    vector<double> cardinalPenalty;
 
-    /* Powers of the abscissa where the value of the basis function is to be
-    calculated */
-    vector<double> powers;
+    /* Coefficients of the differences of the difference penalty */
+    vector<double> difference;
+
+    /* Kernels evaluating the polynomials of the basis functions and of their
+    first and second derivatives */
+    HornerKernel kernelD0 = &hornerAnyDegree;
+    HornerKernel kernelD1 = &hornerAnyDegree;
+    HornerKernel kernelD2 = &hornerAnyDegree;
 
     ////////////////////////////////////////////////////////////////////////////
 
-    /* Finds the knots in common, given two sets of knots */
-    void findKnotsInCommon(const vector<double>& knotsAlpha,
-                           const vector<double>& knotsBeta,
-                           vector<double>& knotsInCommon);
-
-    /* Sums the basisAlpha and basisBeta basis functions. The basis functions
-    must be separated by a single knot */
-    void sumBasisFunctions(vector<vector<double>> basisAlpha,
-                           vector<vector<double>> basisBeta,
-                           int degree /* of the basis functions */,
-                           int index /* of the first knot */,
-                           vector<vector<double>>& basisSum);
-
-    // FOR TESTING PURPOSES ONLY:
-    /* Calculates the value of the second derivative of the basis function at
-    position x on the x-axis */
-    double D2(double x);
+    /* Calculates the polynomials of the basis functions with the Cox-de Boor
+    recurrence. They are multiplied by maxHeight */
+    void calculateDeBoorCoefficients(double maxHeight);
+
+    /* Calculates the polynomials of the basis functions from the cardinal
+    B-spline of degree g. The knots must be equally spaced. They are
+    multiplied by maxHeight */
+    void calculateCardinalCoefficients(double maxHeight);
+
+    /* Evaluates basis function j, whose polynomials of degree 'degree' are
+    saved in 'coefficients' as in coefficientsD0, at position x */
+    double evaluate(const vector<double>& coefficients,
+                    HornerKernel kernel,
+                    int degree,
+                    int j,
+                    double x) const;
+
+    /* Calculates the nodes and weights of the Gauss-Legendre quadrature with
+    numberOfNodes nodes */
+    void calculateGaussLegendre(int numberOfNodes);
+
+    /* Calculates the second derivatives at x, inside knot interval q, of the
+    m basis functions which are non-zero there, and saves them in valuesD2.
+    They are calculated with de Boor's recurrence for the basis functions and
+    their derivatives at x, which only involves the distances between x and
+    the knots around it, so that, unlike the coefficients in powers of x, it
+    does not lose precision when the knots are far from the origin */
+    void secondDerivativesAt(int q, double x);
 
 };
 
@@ -87,302 +209,456 @@ private:
 
 
 
-void BasisFunction::calculateCoefficients(int indexFirstKnot,
-                                          const vector<double>& knots) {
+void BasisFunctions::calculateCoefficients(
+    const vector<double>& knotsForCalculations, int degree) {
 
-    j = indexFirstKnot;
+    g = degree;
+    m = g + 1;
 
-    for (int i=j; i<=j+m; ++i)
-        knotsAll.push_back(knots[i]);
+    knots = knotsForCalculations;
+    int numberOfKnots = knots.size();
+    K = numberOfKnots - m;
 
-    int numberOfPolynomials = knots.size() - 1;
-    double firstRealKnot = knots[g];
-    double lastRealKnot = knots[numberOfPolynomials-g];
-    for (int i=0; i<=m; ++i)
-        if (knotsAll[i] >= firstRealKnot)
-            if (knotsAll[i] <= lastRealKnot)
-                knotsReal.push_back(knotsAll[i]);
+    kernelD0 = hornerKernel(g);
+    kernelD1 = hornerKernel(g-1);
+    kernelD2 = hornerKernel(g-2);
 
-    indexOfFirstRealKnot = 0;
-    for (int i=0; i<m; ++i)
-        if (knotsAll[i] >= firstRealKnot) {
-            indexOfFirstRealKnot = i;
-            break;
-        }
+    coefficientsD0.assign(K*m*m,0);
+    coefficientsD1.assign(K*m*m,0);
+    coefficientsD2.assign(K*m*m,0);
 
-    maxHeight = (knots.back()-knots[0])/numberOfPolynomials*(double)m;
+    // The product of two second derivatives has degree 2g-4, so g-1 nodes are
+    // enough to integrate it exactly
+    int numberOfNodes = max(g-1,1);
+    if ((int)gaussNodes.size() != numberOfNodes)
+        calculateGaussLegendre(numberOfNodes);
 
-    // The 'pyramid' vector of vectors of vectors will contain the coefficients
-    // of the basis function
+    // Maximum height the basis functions might reach, if they were the
+    // leftmost or rightmost basis function of the spline. It multiplies all
+    // the basis functions
+    spacing = (knots.back()-knots[0])/(double)(numberOfKnots-1);
+    double maxHeight = spacing*(double)m;
 
-    vector<vector<vector<vector<double>>>> pyramid;
-    for (int a=0; a<g; ++a) {
-        vector<vector<vector<double>>> pyramidLevel;
-        auto basis = vector<vector<double>>(a+1,vector<double>(m,0));
-        for (int b=0; b<m-a; ++b)
-            pyramidLevel.push_back(basis);
-        pyramid.push_back(pyramidLevel);
-    }
+    // The knots are considered equally spaced if the distances between them
+    // differ only because of rounding
+    uniform = g <= maximumCardinalDegree;
+    for (int i=0; i<numberOfKnots-1 && uniform; ++i)
+        if (fabs(knots[i+1]-knots[i]-spacing) > 1e-10*spacing)
+            uniform = false;
 
-    for (int b=0; b<m; ++b)
-        pyramid[0][b][0][0] = maxHeight;
-
-    for (int a=1; a<g; ++a)
-        for (int b=0; b<m-a; ++b)
-            sumBasisFunctions(pyramid[a-1][b],
-                              pyramid[a-1][b+1],
-                              a /*degree of the basis functions*/,
-                              b /*index of the first knot*/,
-                              pyramid[a][b]);
-
-    // coefficientsD0 is equal to the top of 'pyramid'
-    coeffD0 = vector<vector<double>>(m,vector<double>(m,0));
-    sumBasisFunctions(pyramid[g-1][0],
-                      pyramid[g-1][1],
-                      g /*degree of the basis functions*/,
-                      0 /*index of the first knot*/,
-                      coeffD0);
-
-    coeffD1 = vector<vector<double>>(m,vector<double>(m,0));
-    for (int i=0; i<m; ++i)
-        for (int a=1; a<m; ++a)
-            coeffD1[i][a-1] = (double)a*coeffD0[i][a];
+    if (uniform)
+        calculateCardinalCoefficients(maxHeight);
+    else
+        calculateDeBoorCoefficients(maxHeight);
 
-    coeffD2 = vector<vector<double>>(m,vector<double>(m,0));
-    for (int i=0; i<m; ++i)
+    for (int i=0; i<K*m; ++i) {
+        const double* D0 = &coefficientsD0[i*m];
+        double* D1 = &coefficientsD1[i*m];
+        double* D2 = &coefficientsD2[i*m];
+        for (int a=1; a<m; ++a)
+            D1[a-1] = (double)a*D0[a];
         for (int a=2; a<m; ++a)
-            coeffD2[i][a-2] = (double)(a*(a-1))*coeffD0[i][a];
+            D2[a-2] = (double)(a*(a-1))*D0[a];
+    }
+
+}
+
+
+
+void BasisFunctions::calculateDeBoorCoefficients(double maxHeight) {
+
+    int numberOfKnots = knots.size();
+
+    level.resize(m*m);
+    alpha.resize(m);
+    beta.resize(m);
 
-    powers = vector<double>(m,1);
+    // For each knot interval q, the recurrence calculates the polynomials of
+    // degree d of the basis functions q-d, ..., q, which are the only ones
+    // non-zero inside the interval, from those of degree d-1. Basis function i
+    // of degree d is defined on knots i, ..., i+d+1. The polynomial of basis
+    // function q-d+k is saved in 'level' at position k*m
+    for (int q=0; q<numberOfKnots-1; ++q) {
+
+        fill(level.begin(), level.end(), 0.);
+        level[0] = maxHeight;
+
+        for (int d=1; d<=g; ++d) {
+
+            // Proceeding from the last basis function, the polynomial of each
+            // basis function replaces one which is no longer needed
+            for (int k=d; k>=0; --k) {
+
+                int i = q - d + k;
+                double* polynomial = &level[k*m];
+
+                // Basis functions extending outside the knots are not needed
+                if (i < 0 || i+d+1 > numberOfKnots-1) {
+                    fill(polynomial, polynomial+m, 0.);
+                    continue;
+                }
+
+                // alpha = N(i,d-1) * ( t - u_i ) / ( u_i+d - u_i )
+                bool withAlpha = k >= 1;
+                if (withAlpha) {
+                    const double* basisAlpha = &level[(k-1)*m];
+                    for (int b=0; b<m; ++b)
+                        alpha[b] = basisAlpha[b];
+                    // alpha * t
+                    for (int b=d; b>0; --b)
+                        alpha[b] = alpha[b-1];
+                    alpha[0] = 0;
+                    // alpha * -u_i
+                    for (int b=0; b<d; ++b)
+                        alpha[b] -= alpha[b+1] * knots[i];
+                    // alpha / ( u_i+d - u_i )
+                    for (int b=0; b<=d; ++b)
+                        alpha[b] /= (knots[i+d] - knots[i]);
+                }
+
+                // beta = N(i+1,d-1) * ( u_i+d+1 - t ) / ( u_i+d+1 - u_i+1 )
+                bool withBeta = k <= d-1;
+                if (withBeta) {
+                    for (int b=0; b<m; ++b)
+                        beta[b] = polynomial[b];
+                    // beta * -t
+                    for (int b=d; b>0; --b)
+                        beta[b] = -beta[b-1];
+                    beta[0] = 0;
+                    // beta * u_i+d+1
+                    for (int b=0; b<d; ++b)
+                        beta[b] -= beta[b+1] * knots[i+d+1];
+                    // beta / ( u_i+d+1 - u_i+1 )
+                    for (int b=0; b<=d; ++b)
+                        beta[b] /= (knots[i+d+1] - knots[i+1]);
+                }
+
+                // N(i,d) = alpha + beta
+                for (int b=0; b<m; ++b) {
+                    if (b > d)
+                        polynomial[b] = 0;
+                    else if (withAlpha && withBeta)
+                        polynomial[b] = alpha[b] + beta[b];
+                    else if (withAlpha)
+                        polynomial[b] = alpha[b];
+                    else
+                        polynomial[b] = beta[b];
+                }
+
+            }
+
+        }
+
+        // Saves the polynomials of the basis functions of degree g
+        for (int k=0; k<=g; ++k) {
+            int j = q - g + k;
+            if (j < 0 || j >= K)
+                continue;
+            int p = q - j;
+            copy(&level[k*m], &level[k*m]+m, &coefficientsD0[(j*m+p)*m]);
+        }
+
+    }
 
 }
 
 
 
-double BasisFunction::D0(double x) {
+void BasisFunctions::calculateCardinalCoefficients(double maxHeight) {
 
-    // If x is outside the knots or equal to the rightmost knot, the basis
-    // function is equal to 0
-    if (x < knotsAll[0] || x >= knotsAll[m]) return 0;
+    double factorial = 1;
+    for (int a=2; a<=g; ++a)
+        factorial *= (double)a;
+
+    for (int j=0; j<K; ++j)
+        for (int p=0; p<m; ++p) {
+
+            double* polynomial = &coefficientsD0[(j*m+p)*m];
+            double leftKnot = knots[j+p];
+
+            // Polynomial in terms of (x-leftKnot), from the polynomial in
+            // terms of s = (x-leftKnot)/spacing
+            double scale = maxHeight/factorial;
+            for (int a=0; a<m; ++a) {
+                polynomial[a] = cardinalBSplines[g][p][a]*scale;
+                scale /= spacing;
+            }
+
+            // Polynomial in terms of x, by repeated synthetic division
+            for (int a=0; a<g; ++a)
+                for (int b=g-1; b>=a; --b)
+                    polynomial[b] -= leftKnot*polynomial[b+1];
 
-    int indexOfPolynomial = 0;
-    for (int i=0; i<m; ++i)
-        if (x < knotsAll[i+1]) {
-            indexOfPolynomial = i;
-            break;
         }
 
-    // Calculates the powers of x
-    for (int i=1; i<m; ++i)
-        powers[i] = powers[i-1]*x;
+}
 
-    // Calculates D0(x)
-    double y = 0;
-    for (int i=0; i<m; ++i)
-        y += coeffD0[indexOfPolynomial][i]*powers[i];
 
-    return y;
+
+const double* BasisFunctions::coeffD0(int j, int p) const {
+
+    return &coefficientsD0[(j*m+p)*m];
 
 }
 
 
 
-double BasisFunction::D1(double x) {
+const double* BasisFunctions::coeffD1(int j, int p) const {
+
+    return &coefficientsD1[(j*m+p)*m];
+
+}
+
+
+
+const double* BasisFunctions::coeffD2(int j, int p) const {
+
+    return &coefficientsD2[(j*m+p)*m];
+
+}
+
+
+
+double BasisFunctions::evaluate(const vector<double>& coefficients,
+                                HornerKernel kernel,
+                                int degree,
+                                int j,
+                                double x) const {
 
     // If x is outside the knots or equal to the rightmost knot, the basis
     // function is equal to 0
-    if (x < knotsAll[0] || x >= knotsAll[m]) return 0;
+    if (x < knots[j] || x >= knots[j+m]) return 0;
 
     int indexOfPolynomial = 0;
     for (int i=0; i<m; ++i)
-        if (x < knotsAll[i+1]) {
+        if (x < knots[j+i+1]) {
             indexOfPolynomial = i;
             break;
         }
 
-    // Calculates the powers of x
-    for (int i=1; i<g; ++i)
-        powers[i] = powers[i-1]*x;
+    return kernel(&coefficients[(j*m+indexOfPolynomial)*m], degree, x);
 
-    // Calculates D1(x)
-    double y = 0;
-    for (int i=0; i<g; ++i)
-        y += coeffD1[indexOfPolynomial][i]*powers[i];
+}
 
-    return y;
 
-}
 
+double BasisFunctions::D0(int j, double x) const {
 
+    return evaluate(coefficientsD0, kernelD0, g, j, x);
 
-double BasisFunction::integralOfProductD2(const BasisFunction& basisFunction) {
+}
 
-    // knotsInCommon will contain the real knots in common
-    vector<double> knotsInCommon;
 
-    findKnotsInCommon(knotsReal, basisFunction.knotsReal, knotsInCommon);
 
-    int numberOfKnotsInCommon = knotsInCommon.size();
+double BasisFunctions::D1(int j, double x) const {
 
-    // D2Basis1 and D2Basis2 will contain the coefficients of the second
-    // derivatives of the basis functions for the segments between real knots in
-    // common to both basis functions
+    return evaluate(coefficientsD1, kernelD1, g-1, j, x);
 
-    vector<vector<double>> D2Basis1;
-    vector<vector<double>> D2Basis2;
+}
 
-    for (int a=indexOfFirstRealKnot; a<m; ++a)
-        if (knotsAll[a] == knotsInCommon[0]) {
-            for (int b=0; b<numberOfKnotsInCommon-1; ++b)
-                D2Basis1.push_back(coeffD2[a+b]);
-            break;
-        }
 
-    for (int a=basisFunction.indexOfFirstRealKnot; a<m; ++a)
-        if (basisFunction.knotsAll[a] == knotsInCommon[0]) {
-            for (int b=0; b<numberOfKnotsInCommon-1; ++b)
-                D2Basis2.push_back(basisFunction.coeffD2[a+b]);
-            break;
-        }
 
-    int numberOfPolynomialsInCommon = D2Basis1.size();
-    int mTimesTwoMinusFive = m*2-5;
-
-    // productD2 will contain the coefficients of the product of the second
-    // derivatives of the basis functions
-    auto productD2 =
-        vector<vector<double>>(numberOfPolynomialsInCommon,
-        vector<double>(mTimesTwoMinusFive,0));
-
-    // For each segments calculates the coefficients of the product of the
-    // second derivatives of the basis functions
-    int mMinus2 = m-2;
-    for (int i=0; i<numberOfPolynomialsInCommon; ++i)
-        for (int a=0; a<mMinus2; ++a)
-            for (int b=0; b<mMinus2; ++b)
-                productD2[i][a+b] += D2Basis1[i][a] * D2Basis2[i][b];
-
-    // Calculates the powers of each knot in common
-    auto powersKnotsInCommon =
-        vector<vector<double>>(numberOfKnotsInCommon,vector<double>(m*2-4,1));
-    for (int i=0; i<numberOfKnotsInCommon; ++i)
-        for (int a=1; a<=mTimesTwoMinusFive; ++a)
-            powersKnotsInCommon[i][a] =
-                powersKnotsInCommon[i][a-1]*knotsInCommon[i];
-
-    // Calculates the integral, segment by segment
-    double integral = 0;
-    for (int i=0; i<numberOfPolynomialsInCommon; ++i)
-        for (int a=mTimesTwoMinusFive; a>0; --a)
-            integral +=
-            (((productD2[i][a-1]/(double)a)*powersKnotsInCommon[i+1][a])-
-            ((productD2[i][a-1]/(double)a)*powersKnotsInCommon[i][a]));
-
-    return integral;
+double BasisFunctions::D2(int j, double x) const {
+
+    return evaluate(coefficientsD2, kernelD2, g-2, j, x);
 
 }
 
 
 
-void BasisFunction::findKnotsInCommon(const vector<double>& knotsAlpha,
-                                      const vector<double>& knotsBeta,
-                                      vector<double>& knotsInCommon) {
+void BasisFunctions::calculatePenalty(BandMatrix& R) {
 
-    int knotsAlphaSize = knotsAlpha.size();
-    int knotsBetaSize = knotsBeta.size();
+    R.resize(K,g);
 
-    for (int a=0; a<knotsAlphaSize; ++a)
-        for (int b=0; b<knotsBetaSize; ++b)
-            if (knotsAlpha[a] == knotsBeta[b]) {
-                if (knotsAlphaSize-a <= knotsBetaSize-b) {
-                    for (int c=a; c<knotsAlphaSize; ++c)
-                        knotsInCommon.push_back(knotsAlpha[c]);
-                    return;
-                }
-                else {
-                    for (int c=b; c<knotsBetaSize; ++c)
-                        knotsInCommon.push_back(knotsBeta[c]);
-                    return;
-                }
-            }
+    int numberOfKnots = knots.size();
 
-}
+    if (uniform) {
 
+        // The second derivatives of the polynomials of the cardinal B-spline
+        // have degree g-2, so their products are integrated exactly between 0
+        // and 1 from their coefficients
+        cardinalPenalty.assign(m*m,0);
+        for (int k=0; k<m; ++k)
+            for (int l=0; l<=k; ++l) {
+                const double* polynomialK = cardinalBSplines[g][g-k];
+                const double* polynomialL = cardinalBSplines[g][g-l];
+                double integral = 0;
+                for (int a=2; a<m; ++a)
+                    for (int b=2; b<m; ++b)
+                        integral += (double)(a*(a-1)*b*(b-1))*
+                                    polynomialK[a]*polynomialL[b]/
+                                    (double)(a+b-3);
+                cardinalPenalty[k*m+l] = integral;
+            }
 
+        // Basis function j is maxHeight/g! times the cardinal B-spline of
+        // (x-knots[j])/spacing, so the integrals are multiplied by the square
+        // of maxHeight/g! and divided by the cube of spacing
+        double factorial = 1;
+        for (int a=2; a<=g; ++a)
+            factorial *= (double)a;
+        double scale = spacing*(double)m/factorial;
+        scale = scale*scale/(spacing*spacing*spacing);
 
-void BasisFunction::sumBasisFunctions(vector<vector<double>> basisAlpha,
-                                      vector<vector<double>> basisBeta,
-                                      int degree /* of the basis functions */,
-                                      int index /* of the first knot */,
-                                      vector<vector<double>>& basisSum) {
+        // Each knot interval between the real knots adds the same block
+        for (int q=g; q<=numberOfKnots-2-g; ++q)
+            for (int k=0; k<m; ++k)
+                for (int l=0; l<=k; ++l)
+                    R(q-g+k,q-g+l) += scale*cardinalPenalty[k*m+l];
 
-    int order = degree + 1;
+        return;
 
-    // basisAlpha * ( t - u_index ) / ( u_index+p - u_index )
-    for (int a=0; a<degree; ++a) {
-        // basisAlpha * t
-        for (int b=degree; b>0; --b)
-            basisAlpha[a][b] = basisAlpha[a][b-1];
-        basisAlpha[a][0] = 0;
-        // basisAlpha * -u_index
-        for (int b=0; b<degree; ++b)
-            basisAlpha[a][b] -= basisAlpha[a][b+1] * knotsAll[index];
     }
-    // basisAlpha / ( u_index+p - u_index )
-    for (int a=0; a<degree; ++a)
-        for (int b=0; b<order; ++b)
-            basisAlpha[a][b] /= (knotsAll[index+degree] - knotsAll[index]);
-
-    // basisBeta * ( u_index+p+1 - t ) / ( u_index+p+1 - u_index+1 )
-    for (int a=0; a<degree; ++a) {
-        // basisBeta * -t
-        for (int b=degree; b>0; --b)
-            basisBeta[a][b] = -basisBeta[a][b-1];
-        basisBeta[a][0] = 0;
-        // basisBeta * u_index+p+1
-        for (int b=0; b<degree; ++b)
-            basisBeta[a][b] -= basisBeta[a][b+1] * knotsAll[index+order];
+    int numberOfNodes = gaussNodes.size();
+    valuesD2.resize(m);
+    leftDistances.resize(m);
+    rightDistances.resize(m);
+
+    // Only the basis functions q-g, ..., q are non-zero inside knot interval q,
+    // so each interval between the real knots adds a block of m*m elements
+    for (int q=g; q<=numberOfKnots-2-g; ++q) {
+
+        double halfWidth = 0.5*(knots[q+1]-knots[q]);
+        double middle = 0.5*(knots[q+1]+knots[q]);
+
+        for (int node=0; node<numberOfNodes; ++node) {
+
+            double x = middle + halfWidth*gaussNodes[node];
+
+            secondDerivativesAt(q, x);
+
+            double weight = halfWidth*gaussWeights[node];
+            for (int k=0; k<m; ++k)
+                for (int l=0; l<=k; ++l)
+                    R(q-g+k,q-g+l) += weight*valuesD2[k]*valuesD2[l];
+
+        }
+
     }
-    // basisBeta * ( u_index+p+1 - u_index+1 )
-    for (int a=0; a<degree; ++a)
-        for (int b=0; b<order; ++b)
-            basisBeta[a][b] /= (knotsAll[index+order] - knotsAll[index+1]);
-
-    // basisAlpha + basisBeta = basisSum
-    for (int a=0; a<order; ++a) {
-        if (a==0)
-            basisSum[0] = basisAlpha[0];
-        else if (a==degree)
-            basisSum[degree] = basisBeta[degree-1];
-        else
-            for (int b=0; b<order; ++b)
-                basisSum[a][b] = basisAlpha[a][b] + basisBeta[a-1][b];
+
+}
+
+
+
+void BasisFunctions::secondDerivativesAt(int q, double x) {
+
+    fill(valuesD2.begin(), valuesD2.end(), 0.);
+    if (g < 2)
+        return;
+
+    // Values at x of the basis functions of degree g-2 which are non-zero
+    // inside knot interval q. Basis function q-d+k of degree d is saved at
+    // position k
+    valuesD2[0] = 1;
+    for (int d=1; d<=g-2; ++d) {
+        leftDistances[d] = x - knots[q+1-d];
+        rightDistances[d] = knots[q+d] - x;
+        double saved = 0;
+        for (int k=0; k<d; ++k) {
+            double term = valuesD2[k]/(rightDistances[k+1]+leftDistances[d-k]);
+            valuesD2[k] = saved + rightDistances[k+1]*term;
+            saved = leftDistances[d-k]*term;
+        }
+        valuesD2[d] = saved;
     }
 
+    // The derivative of basis function i of degree d is
+    // d*(N(i,d-1)/(u_i+d - u_i) - N(i+1,d-1)/(u_i+d+1 - u_i+1)), applied
+    // twice, for degree g-1 and then g. Proceeding from the last basis
+    // function, each result replaces a value which is no longer needed
+    for (int d=g-1; d<=g; ++d)
+        for (int k=d; k>=0; --k) {
+            int i = q - d + k;
+            double derivative = 0;
+            if (k >= 1)
+                derivative += valuesD2[k-1]/(knots[i+d]-knots[i]);
+            if (k <= d-1)
+                derivative -= valuesD2[k]/(knots[i+d+1]-knots[i+1]);
+            valuesD2[k] = (double)d*derivative;
+        }
+
+    // The basis functions are multiplied by maxHeight
+    double maxHeight = spacing*(double)m;
+    for (int k=0; k<m; ++k)
+        valuesD2[k] *= maxHeight;
+
 }
 
-double BasisFunction::D2(double x) {
 
-    // If x is outside the knots or equal to the rightmost knot, the basis
-    // function is equal to 0
-    if (x < knotsAll[0] || x >= knotsAll[m]) return 0;
 
-    int indexOfPolynomial = 0;
-    for (int i=0; i<m; ++i)
-        if (x < knotsAll[i+1]) {
-            indexOfPolynomial = i;
-            break;
+void BasisFunctions::calculateDifferencePenalty(int order,
+                                                BandMatrix& R) {
+
+    R.resize(K,max(g,order));
+
+    // Coefficients of the differences of the given order, the binomial
+    // coefficients with alternating signs
+    difference.assign(order+1,1);
+    for (int a=1; a<=order; ++a)
+        difference[a] = -difference[a-1]*(double)(order-a+1)/(double)a;
+
+    // Each row r of D contains the differences between the coefficients of
+    // the basis functions r, ..., r+order
+    for (int r=0; r+order<K; ++r)
+        for (int a=0; a<=order; ++a)
+            for (int b=0; b<=a; ++b)
+                R(r+a,r+b) += difference[a]*difference[b];
+
+}
+
+
+
+void BasisFunctions::calculateGaussLegendre(int numberOfNodes) {
+
+    gaussNodes.assign(numberOfNodes,0);
+    gaussWeights.assign(numberOfNodes,0);
+
+    // The nodes are the roots of the Legendre polynomial of degree
+    // numberOfNodes, found with Newton's method. They are symmetric, so only
+    // half of them are calculated
+    for (int i=0; i<(numberOfNodes+1)/2; ++i) {
+
+        double x = cos(M_PI*((double)i+0.75)/((double)numberOfNodes+0.5));
+        double derivative = 1;
+
+        for (int iteration=0; iteration<100; ++iteration) {
+
+            // Legendre polynomial from the three-term recurrence
+            double p0 = 1;
+            double p1 = 0;
+            for (int n=1; n<=numberOfNodes; ++n) {
+                double p2 = p1;
+                p1 = p0;
+                p0 = ((2.*n-1.)*x*p1-(n-1.)*p2)/(double)n;
+            }
+            derivative = (double)numberOfNodes*(x*p0-p1)/(x*x-1.);
+
+            double step = p0/derivative;
+            x -= step;
+            if (fabs(step) <= 1e-15)
+                break;
+
         }
 
-    // Calculates the powers of x
-    for (int i=1; i<m-2; ++i)
-        powers[i] = powers[i-1]*x;
+        gaussNodes[i] = -x;
+        gaussNodes[numberOfNodes-1-i] = x;
+        gaussWeights[i] = 2./((1.-x*x)*derivative*derivative);
+        gaussWeights[numberOfNodes-1-i] = gaussWeights[i];
 
-    // Calculates D2(x)
-    double y = 0;
-    for (int i=0; i<m-2; ++i)
-        y += coeffD2[indexOfPolynomial][i]*powers[i];
+    }
+
+}
 
-    return y;
 
-}
\ No newline at end of file
+
+size_t BasisFunctions::reservedBytes() const {
+
+    return (knots.capacity() + coefficientsD0.capacity() +
+            coefficientsD1.capacity() + coefficientsD2.capacity() +
+            level.capacity() + alpha.capacity() + beta.capacity() +
+            gaussNodes.capacity() + gaussWeights.capacity() +
+            valuesD2.capacity() + leftDistances.capacity() +
+            rightDistances.capacity() + cardinalPenalty.capacity() +
+            difference.capacity())*sizeof(double);
+
+}
@@ -0,0 +1,271 @@
+
+/* Number of times an interval is halved while isolating the roots of a
+polynomial. The roots still not isolated after it are multiple roots, or roots
+so close to each other that they are reported as one */
+const int maximumBernsteinSubdivisions = 40;
+
+
+
+/* Calculates the coefficients, from the constant term up, of the polynomial
+q(t) = p(left + t*(right-left)), where p(x) is the polynomial of degree
+'degree' whose coefficients are 'coefficients', so that the interval
+[left,right] of p corresponds to the interval [0,1] of q */
+void mapToUnitInterval(const double* coefficients,
+                       int degree,
+                       double left,
+                       double right,
+                       double* local) {
+
+    copy(coefficients, coefficients+degree+1, local);
+    shiftPolynomial(local, degree, left);
+
+    double width = right-left;
+    double power = 1;
+    for (int a=1; a<=degree; ++a) {
+        power *= width;
+        local[a] *= power;
+    }
+
+}
+
+
+
+/* Calculates the coefficients in the Bernstein basis of degree 'degree' on
+[0,1] of the polynomial whose coefficients, from the constant term up, are
+'local' */
+void bernsteinFromPower(const double* local, int degree, double* bernstein) {
+
+    // bernstein[i] is the sum over j <= i of binomial(i,j)/binomial(degree,j)
+    // times local[j]. Both binomials are updated from the previous ones
+    for (int i=0; i<=degree; ++i)
+        bernstein[i] = 0;
+
+    double inverseBinomial = 1; // 1/binomial(degree,j)
+    for (int j=0; j<=degree; ++j) {
+        double binomial = 1; // binomial(i,j)
+        for (int i=j; i<=degree; ++i) {
+            bernstein[i] += binomial*inverseBinomial*local[j];
+            binomial = binomial*(double)(i+1)/(double)(i+1-j);
+        }
+        if (j < degree)
+            inverseBinomial = inverseBinomial*(double)(j+1)/(double)(degree-j);
+    }
+
+}
+
+
+
+/* Calculates lower and upper bounds of the polynomial of degree 'degree'
+whose coefficients, from the constant term up, are 'coefficients' on
+[left,right]: the smallest and the largest of its Bernstein coefficients on
+the interval, which contain the polynomial in their convex hull. The bounds
+are exact for polynomials of degree at most 1, and become tighter as the
+interval gets shorter */
+void bernsteinBounds(const double* coefficients,
+                     int degree,
+                     double left,
+                     double right,
+                     double& lowest,
+                     double& highest) {
+
+    // The coefficients are kept on the stack for the degrees with a
+    // specialized Horner kernel, the only ones used by the splines
+    double onStack[2*(maximumKernelDegree+1)] = {};
+    vector<double> onHeap;
+    if (degree > maximumKernelDegree)
+        onHeap.resize(2*(degree+1));
+    double* local = degree > maximumKernelDegree ? onHeap.data() : onStack;
+    double* bernstein = local + degree+1;
+
+    mapToUnitInterval(coefficients, degree, left, right, local);
+    bernsteinFromPower(local, degree, bernstein);
+
+    lowest = *min_element(bernstein, bernstein+degree+1);
+    highest = *max_element(bernstein, bernstein+degree+1);
+
+}
+
+
+
+/* Calculates with de Casteljau's algorithm the Bernstein coefficients of the
+two halves of the interval, given those of the whole interval */
+void subdivideBernstein(const double* bernstein,
+                        int degree,
+                        double* leftHalf,
+                        double* rightHalf) {
+
+    // Level r of the algorithm overwrites the first degree-r+1 elements of
+    // rightHalf, so element i keeps the last value of level degree-i, which is
+    // coefficient i of the right half
+    copy(bernstein, bernstein+degree+1, rightHalf);
+    leftHalf[0] = rightHalf[0];
+
+    for (int r=1; r<=degree; ++r) {
+        for (int i=0; i<=degree-r; ++i)
+            rightHalf[i] = 0.5*(rightHalf[i]+rightHalf[i+1]);
+        leftHalf[r] = rightHalf[0];
+    }
+
+}
+
+
+
+/* Returns the number of sign changes in the Bernstein coefficients, ignoring
+those equal to 0. It is an upper bound on the number of roots inside the
+interval, with the same parity */
+int signChanges(const double* bernstein, int degree) {
+
+    int changes = 0;
+    double previous = 0;
+
+    for (int i=0; i<=degree; ++i)
+        if (bernstein[i] != 0) {
+            if (previous != 0 && (bernstein[i] > 0) != (previous > 0))
+                ++changes;
+            previous = bernstein[i];
+        }
+
+    return changes;
+
+}
+
+
+
+/* Returns the root of the polynomial q whose coefficients are 'local' inside
+[lo,hi], where q changes sign, found by bisection */
+double bisectRoot(const double* local, int degree, double lo, double hi) {
+
+    double valueLo = hornerAnyDegree(local, degree, lo);
+    double valueHi = hornerAnyDegree(local, degree, hi);
+
+    // Rounding can hide the change of sign, in which case the end point
+    // closer to 0 is the best estimate
+    if ((valueLo > 0) == (valueHi > 0) || valueLo == 0 || valueHi == 0)
+        return fabs(valueLo) <= fabs(valueHi) ? lo : hi;
+
+    for (int iteration=0; iteration<100; ++iteration) {
+        double middle = 0.5*(lo+hi);
+        if (!(middle > lo && middle < hi))
+            break;
+        double valueMiddle = hornerAnyDegree(local, degree, middle);
+        if (valueMiddle == 0)
+            return middle;
+        if ((valueMiddle > 0) == (valueLo > 0)) {
+            lo = middle;
+            valueLo = valueMiddle;
+        }
+        else
+            hi = middle;
+    }
+
+    return 0.5*(lo+hi);
+
+}
+
+
+
+/* Appends to 'roots' the roots in [lo,hi] of the polynomial q whose
+coefficients are 'local' and whose Bernstein coefficients on [lo,hi] are
+'bernstein', sorted from smallest to largest. The end point lo is excluded.
+'work' holds the coefficients of the halves of the intervals, two sets for
+each level of subdivision below 'level' */
+void isolateRoots(const double* local,
+                  int degree,
+                  const double* bernstein,
+                  double lo,
+                  double hi,
+                  int level,
+                  double* work,
+                  vector<double>& roots) {
+
+    int changes = signChanges(bernstein, degree);
+
+    if (changes == 0) {
+        if (bernstein[degree] == 0)
+            roots.push_back(hi);
+        return;
+    }
+
+    // A single change of sign between non-zero end points means a single
+    // simple root
+    if (changes == 1 && bernstein[0] != 0 && bernstein[degree] != 0) {
+        roots.push_back(bisectRoot(local, degree, lo, hi));
+        return;
+    }
+
+    if (level == maximumBernsteinSubdivisions) {
+        roots.push_back(0.5*(lo+hi));
+        if (bernstein[degree] == 0)
+            roots.push_back(hi);
+        return;
+    }
+
+    double* leftHalf = work + 2*level*(degree+1);
+    double* rightHalf = leftHalf + degree+1;
+    subdivideBernstein(bernstein, degree, leftHalf, rightHalf);
+
+    double middle = 0.5*(lo+hi);
+    isolateRoots(local, degree, leftHalf, lo, middle, level+1, work, roots);
+    isolateRoots(local, degree, rightHalf, middle, hi, level+1, work, roots);
+
+}
+
+
+
+/* Appends to 'roots' the real roots in [left,right] of the polynomial of
+degree 'degree' whose coefficients, from the constant term up, are
+'coefficients', sorted from smallest to largest. Roots are isolated by
+subdividing the interval until the Bernstein coefficients change sign at
+most once, and then refined by bisection. Multiple roots are reported once.
+Polynomials equal to 0 have no roots reported */
+void realRootsInInterval(const double* coefficients,
+                         int degree,
+                         double left,
+                         double right,
+                         vector<double>& roots) {
+
+    if (degree < 1 || !(right > left))
+        return;
+
+    // The coefficients and the halves of the intervals are kept on the stack
+    // for the degrees with a specialized Horner kernel, the only ones used by
+    // the splines
+    double onStack[(2+2*maximumBernsteinSubdivisions)*(maximumKernelDegree+1)];
+    vector<double> onHeap;
+    if (degree > maximumKernelDegree)
+        onHeap.resize((2+2*maximumBernsteinSubdivisions)*(degree+1));
+    double* local = degree > maximumKernelDegree ? onHeap.data() : onStack;
+    double* bernstein = local + degree+1;
+    double* work = bernstein + degree+1;
+
+    mapToUnitInterval(coefficients, degree, left, right, local);
+    bernsteinFromPower(local, degree, bernstein);
+
+    bool zeroPolynomial = true;
+    for (int i=0; i<=degree; ++i)
+        if (bernstein[i] != 0)
+            zeroPolynomial = false;
+    if (zeroPolynomial)
+        return;
+
+    // The roots on [0,1] are appended to 'roots', and then replaced by the
+    // corresponding ones on [left,right]
+    int first = roots.size();
+    if (bernstein[0] == 0)
+        roots.push_back(0);
+    isolateRoots(local, degree, bernstein, 0, 1, 0, work, roots);
+
+    // Maps the roots back to [left,right]. Multiple roots can be found more
+    // than once at the deepest level of subdivision, in neighbouring intervals
+    double width = right-left;
+    double resolution = 2.*ldexp(width, -maximumBernsteinSubdivisions);
+    int last = first;
+    for (int i=first; i<(int)roots.size(); ++i) {
+        double t = roots[i];
+        double root = t < 1 ? min(left + t*width, right) : right;
+        if (last == 0 || root > roots[last-1]+resolution)
+            roots[last++] = root;
+    }
+    roots.resize(last);
+
+}
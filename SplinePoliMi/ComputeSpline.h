@@ -1,37 +1,50 @@
-/* Generates the splines according to the splineTypes and number of points */
-vector<Spline> calculateSplines(vector<double> x, vector<double> y, int splineType) {
+/* Generates the splines according to the splineTypes and number of points. The
+candidate splines, one for each value in
+settings.numberOfAbscissaeSeparatingConsecutiveKnots, are calculated
+concurrently by settings.numberOfThreadsCandidates threads */
+vector<Spline> calculateSplines(const vector<double>& x,
+                                const vector<double>& y,
+                                int splineType,
+                                const Settings& settings) {
 
-    vector<Spline> splines(3);
+    const vector<int>& numberOfAbscissaeSeparatingConsecutiveKnots =
+        settings.numberOfAbscissaeSeparatingConsecutiveKnots;
 
-    vector<int> numberOfAbscissaeSeparatingConsecutiveKnots_vector = {0, 2, 5};
+    // The data are prepared once for all the candidate splines, which share
+    // them
+    auto data = make_shared<SplineData>();
+    data->prepare(x, y, splineType);
+
+    int numberOfSplines = numberOfAbscissaeSeparatingConsecutiveKnots.size();
 
     if (splineType == 1 || x.size() < 3){  // if model or len(x) < 3 --> just one spline
-        splines.resize(1);
+        numberOfSplines = 1;
     }
     else if (x.size() < 5){
-        splines.resize(2);
-    }
-    else{
-        splines.resize(3);
+        numberOfSplines = min(numberOfSplines, 2);
     }
 
-    for (int i = 0; i < (int)splines.size(); i++) {
-        splines[i].solve(x, y, splineType, numberOfAbscissaeSeparatingConsecutiveKnots_vector[i]);
-    }
+    vector<Spline> splines(numberOfSplines);
 
-    return splines;
+    // The pool is kept by the calling thread, so that its threads and their
+    // workspaces are reused by the following calls
+    thread_local unique_ptr<ThreadPool> candidatesPool;
+    ThreadPool& pool =
+        reusableThreadPool(candidatesPool,
+                           min(settings.numberOfThreadsCandidates,
+                               numberOfSplines));
+    pool.run(numberOfSplines, [&](int i) {
+        splines[i].solve(data,
+                         numberOfAbscissaeSeparatingConsecutiveKnots[i],
+                         settings,
+                         threadWorkspace());
+    });
 
-}
+    return splines;
 
-double summedSquaredError(vector <double> b, vector<double> c){
-    double SSE = 0;
-    for(int i=0; i < (int)b.size(); i++){
-        SSE += pow((b[i] - c[i]), 2);
-    }
-    return SSE;
 }
 
-vector<double> logLikeliHood(double n, vector<double> residuals){
+vector<double> logLikeliHood(double n, const vector<double>& residuals){
 
     vector<double> ll;
 
@@ -42,7 +55,9 @@ vector<double> logLikeliHood(double n, vector<double> residuals){
 
 }
 
-vector<vector<double>> informationCriterion(vector<double> ll, int n, vector<int> numOfParam){
+/* Returns AIC, AICc, BIC and the number of parameters k, calculated from the
+effective degrees of freedom of the splines */
+vector<vector<double>> informationCriterion(const vector<double>& ll, int n, const vector<double>& effectiveDegreesOfFreedom){
 
     vector<vector<double>> information ;
     vector<double> AIC;
@@ -51,8 +66,8 @@ vector<vector<double>> informationCriterion(vector<double> ll, int n, vector<int
     vector<double> BIC;
     vector<double> k;
 
-    for(int i=0; i < (int)numOfParam.size();i++)
-        k.push_back(2*(numOfParam[i]+1)+1);
+    for(int i=0; i < (int)effectiveDegreesOfFreedom.size();i++)
+        k.push_back(2*(effectiveDegreesOfFreedom[i]+1)+1);
 
     for(int i=0; i < (int)ll.size();i++){
 
@@ -73,19 +88,21 @@ vector<vector<double>> informationCriterion(vector<double> ll, int n, vector<int
 }
 
 /* Return the index of the minimum element */
-int positionOfMinimum(vector<double> v){
+int positionOfMinimum(const vector<double>& v){
     return min_element(v.begin(), v.end()) - v.begin();
 }
 
 /* Given a vector of Splines return the best spline based on the criterion */
-int calculateBestSpline(vector<Spline> splines, string criterion){
+int calculateBestSpline(const vector<Spline>& splines, const Settings& settings){
+
+    const string& criterion = settings.criterion;
 
     // If the length of splines is 1 then the only spline is the best spline
     if (splines.size() == 1){
         return 0;
     }
 
-    vector<int> numOfParam;
+    vector<double> effectiveDegreesOfFreedom;
     vector<double> AIC;
     vector<double> AICc;
     vector<double> BIC;
@@ -95,26 +112,22 @@ int calculateBestSpline(vector<Spline> splines, string criterion){
     vector<vector<double>> information;
     vector<double> ratioLK;
     vector<double> k;
-    // The original X vector is in every Spline. I take it from the first one
-    int numOfObs = splines[0].originalAbscissae.size();
+    // The candidates are fitted to the same abscissae, which are the original
+    // ones, since only models, always with a single candidate, add points
+    int numOfObs = splines[0].n;
 
-    int indexBestSpline;
+    int indexBestSpline = 0;
 
-    for (int k=0; k < (int)splines.size(); k++){
-        vector<double> ySpl_tmp;
-        for (int i=0; i < numOfObs;i++){
-            ySpl_tmp.push_back(splines[k].D0(splines[0].originalAbscissae[i]));
-        }
-        SSE.push_back(summedSquaredError(splines[0].originalOrdinates, ySpl_tmp));
+    // The sums of squared errors and the effective degrees of freedom were
+    // calculated while fitting the splines
+    for (const Spline& spline : splines){
+        SSE.push_back(spline.SSE);
+        effectiveDegreesOfFreedom.push_back(spline.traceS);
     }
 
     ll = logLikeliHood(numOfObs,SSE);
 
-    for(int i=0; i< (int)splines.size(); i++){
-        numOfParam.push_back(splines[i].K);
-    }
-
-    information = informationCriterion(ll, numOfObs, numOfParam);
+    information = informationCriterion(ll, numOfObs, effectiveDegreesOfFreedom);
 
     AIC = information[0];
     AICc = information[1];
@@ -131,7 +144,7 @@ int calculateBestSpline(vector<Spline> splines, string criterion){
             ratioLK.push_back(k[i] / numOfObs);
         }
         for (int i=0; i < (int)ratioLK.size(); i++){
-            if (ratioLK[i] <= numberOfRatiolkForAICcUse){
+            if (ratioLK[i] <= settings.numberOfRatiolkForAICcUse){
                 AICplusAICc.push_back(AICc[i]);
             }
             else{
@@ -149,40 +162,37 @@ int calculateBestSpline(vector<Spline> splines, string criterion){
     return indexBestSpline;
 }
 
-vector<vector<double>> evaluateSpline (Spline best_spline, int der) {
+/* Evaluates the derivative of order 'der' of the spline at graphPoints
+equally spaced abscissae, the last one being the last knot. Returns the
+abscissae and the ordinates */
+vector<vector<double>> evaluateSpline (const Spline& best_spline, int der, int graphPoints) {
 
     auto x_eval = vector<double>(graphPoints);
     auto y_eval = vector<double>(graphPoints);
     vector<vector<double>> spline_evaluate;
 
+    if (graphPoints > 0) {
 
-    double (Spline::*evaluate_function)(double);
+        double distance = (best_spline.knots.back()-best_spline.knots[0]) / (double)(graphPoints);
 
-    if (der == 0){
-        evaluate_function = &Spline::D0;
-    }
-    else if (der == 1){
-        evaluate_function = &Spline::D1;
-    }
-    else if (der == 2){
-        evaluate_function = &Spline::D2;
-    }
-
-    double distance = (best_spline.knots.back()-best_spline.knots[0]) / (double)(graphPoints);
+        for (int b=0; b<graphPoints; ++b){
+            x_eval[b] = best_spline.knots[0]+(double)b*distance;
+        }
 
-    for (int b=0; b<graphPoints; ++b){
-        x_eval[b] = best_spline.knots[0]+(double)b*distance;
-    }
+        x_eval.back() = best_spline.knots.back();
 
-    x_eval.back() = best_spline.knots.back();
+        // Calculates the ordinates, walking the polynomials in order. The last
+        // abscissa is not on the grid, so it is sampled on its own
+        double* y_der[3] = {nullptr, nullptr, nullptr};
+        y_der[der] = y_eval.data();
+        best_spline.sample(x_eval[0], distance, graphPoints-1,
+                           y_der[0], y_der[1], y_der[2]);
 
-    // Calculates the ordinates
+        y_der[der] = &y_eval.back();
+        best_spline.sample(x_eval.back(), 0, 1, y_der[0], y_der[1], y_der[2]);
 
-    for (int b=0; b<graphPoints; ++b){
-        y_eval[b] = (best_spline.*evaluate_function)(x_eval[b]);
     }
 
-
     spline_evaluate.push_back(x_eval);
     spline_evaluate.push_back(y_eval);
 
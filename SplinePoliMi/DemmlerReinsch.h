@@ -0,0 +1,190 @@
+
+class DemmlerReinsch {
+
+public:
+
+    /* Number of basis functions */
+    int K;
+
+    /* Value of lambda used for building the basis */
+    double lambda0;
+
+    /* Basis of the Demmler-Reinsch form. U[i][k] is element i of basis vector
+    k, for i, k < K. UT*(FiTFi+lambda0*R)*U = I and UT*R*U = diag(eigenvalues).
+    U has at least K rows, since the rows are kept with their memory when K
+    decreases */
+    vector<vector<double>> U;
+
+    /* Eigenvalues of R with respect to FiTFi+lambda0*R */
+    vector<double> eigenvalues;
+
+    /* Product of UT and FiTy */
+    vector<double> UTFiTy;
+
+    ////////////////////////////////////////////////////////////////////////////
+
+    /* Diagonalizes FiTFi and R simultaneously. Needs to be done only once for
+    each set of knots, after which the quantities required by GCV1 can be
+    obtained for any lambda without factorizing M. The cost is proportional to
+    K*K*K, and the memory to K*K, since U is dense. Returns false if
+    FiTFi+lambda0*R is not positive definite, in which case the basis cannot be
+    built */
+    bool calculate(const BandMatrix& FiTFi,
+                   const BandMatrix& R,
+                   const vector<double>& FiTy,
+                   double lambda0);
+
+    /* Calculates the spline coefficients for the given lambda, solution of
+    (FiTFi+lambda*R)*coefficients = FiTy. The cost is proportional to K*K */
+    void coefficients(double lambda, vector<double>& coefficients) const;
+
+    /* Calculates the trace of S = Fi*(FiTFi+lambda*R)^-1*FiT for the given
+    lambda */
+    double traceS(double lambda) const;
+
+    /* Memory reserved by the matrices and vectors, in bytes. They keep it when
+    the basis is calculated again */
+    size_t reservedBytes() const;
+
+////////////////////////////////////////////////////////////////////////////////
+
+private:
+
+    /* LDLT decomposition of FiTFi+lambda0*R */
+    BandMatrix B;
+
+    /* Columns of the product of L^-1 and R */
+    vector<vector<double>> LinvR;
+
+    /* Column being calculated, also used by calculateEigenvalues for the
+    subdiagonal of the tridiagonal form */
+    vector<double> column;
+
+};
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+
+
+bool DemmlerReinsch::calculate(const BandMatrix& FiTFi,
+                               const BandMatrix& R,
+                               const vector<double>& FiTy,
+                               double Lambda0) {
+
+    K = FiTFi.K;
+    lambda0 = Lambda0;
+
+    // B = FiTFi + lambda0*R is positive definite even when FiTFi is singular,
+    // which happens for knot intervals without data points. B = L*D*LT
+    B.resize(K,FiTFi.bandwidth);
+    B.sum(FiTFi, lambda0, R);
+    B.factorize();
+
+    for (int i=0; i<K; ++i)
+        if (!(B(i,i) > 0))
+            return false;
+
+    // Calculates C = D^-1/2*L^-1*R*L^-T*D^-1/2. Column j of L^-1*R is
+    // obtained by forward substitution on column j of R, and column j of
+    // L^-1*R*L^-T by forward substitution on row j of L^-1*R. LinvR[j]
+    // contains column j of L^-1*R
+    // Rows are never removed from U and LinvR, so that they keep their memory
+    // when the basis is calculated again with a larger K
+    if ((int)LinvR.size() < K)
+        LinvR.resize(K);
+    for (int j=0; j<K; ++j) {
+        LinvR[j].assign(K,0);
+        for (int i=max(0,j-R.bandwidth); i<=min(K-1,j+R.bandwidth); ++i)
+            LinvR[j][i] = R(i,j);
+        B.forwardSubstitution(LinvR[j]);
+    }
+
+    if ((int)U.size() < K)
+        U.resize(K);
+    for (int i=0; i<K; ++i)
+        U[i].assign(K,0);
+    column.assign(K,0);
+    for (int j=0; j<K; ++j) {
+        for (int i=0; i<K; ++i)
+            column[i] = LinvR[i][j];
+        B.forwardSubstitution(column);
+        for (int i=0; i<K; ++i)
+            U[i][j] = column[i] / sqrt(B(i,i)*B(j,j));
+    }
+
+    // Removes the asymmetry due to rounding errors
+    for (int i=0; i<K; ++i)
+        for (int j=0; j<i; ++j)
+            U[i][j] = U[j][i] = 0.5*(U[i][j]+U[j][i]);
+
+    // C = V*diag(eigenvalues)*VT
+    calculateEigenvalues(U, K, eigenvalues, column);
+
+    // U = L^-T*D^-1/2*V, calculated column by column
+    for (int k=0; k<K; ++k) {
+        for (int i=0; i<K; ++i)
+            column[i] = U[i][k] / sqrt(B(i,i));
+        B.backwardSubstitution(column);
+        for (int i=0; i<K; ++i)
+            U[i][k] = column[i];
+    }
+
+    UTFiTy.assign(K,0);
+    for (int i=0; i<K; ++i)
+        for (int k=0; k<K; ++k)
+            UTFiTy[k] += U[i][k] * FiTy[i];
+
+    return true;
+
+}
+
+
+
+void DemmlerReinsch::coefficients(double lambda,
+                                  vector<double>& coefficients) const {
+
+    // FiTFi+lambda*R = U^-T*diag(1+(lambda-lambda0)*eigenvalues)*U^-1
+    coefficients.assign(K,0);
+    for (int k=0; k<K; ++k) {
+        double weight = UTFiTy[k] / (1.+(lambda-lambda0)*eigenvalues[k]);
+        for (int i=0; i<K; ++i)
+            coefficients[i] += U[i][k] * weight;
+    }
+
+}
+
+
+
+double DemmlerReinsch::traceS(double lambda) const {
+
+    // trace(S) = trace((FiTFi+lambda*R)^-1*FiTFi), and
+    // UT*FiTFi*U = I-lambda0*diag(eigenvalues)
+    double trace = 0;
+    for (int k=0; k<K; ++k)
+        trace += (1.-lambda0*eigenvalues[k]) /
+                 (1.+(lambda-lambda0)*eigenvalues[k]);
+
+    return trace;
+
+}
+
+
+
+size_t DemmlerReinsch::reservedBytes() const {
+
+    size_t bytes = B.reservedBytes();
+    for (const auto* matrix : {&U, &LinvR}) {
+        bytes += matrix->capacity()*sizeof(vector<double>);
+        for (const auto& row : *matrix)
+            bytes += row.capacity()*sizeof(double);
+    }
+    bytes += (eigenvalues.capacity()+UTFiTy.capacity()+column.capacity())*
+             sizeof(double);
+
+    return bytes;
+
+}
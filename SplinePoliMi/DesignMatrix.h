@@ -0,0 +1,179 @@
+
+class DesignMatrix {
+
+public:
+
+    /* Number of rows of the matrix, equal to the number of data points */
+    int n;
+
+    /* Number of columns of the matrix, equal to the number of basis functions
+    */
+    int K;
+
+    /* Maximum number of non-zero elements in each row, equal to the order of
+    the basis functions */
+    int m;
+
+    /* Column of the first element stored for each row */
+    vector<int> firstColumn;
+
+    /* Elements of the matrix, m for each row. Element (i,firstColumn[i]+c) is
+    saved at position i*m+c. Every element of row i outside of the columns
+    firstColumn[i], ..., firstColumn[i]+m-1 is equal to 0 */
+    vector<double> values;
+
+    ////////////////////////////////////////////////////////////////////////////
+
+    /* Calculates the matrix containing the values (derivativeOrder = 0) or the
+    first derivatives (derivativeOrder = 1) of the first K basis functions at
+    the abscissae. The abscissae must lie between the first and the last real
+    knot */
+    void build(const vector<double>& abscissae,
+               const vector<double>& knotsForCalculations,
+               const BasisFunctions& basisFunctions,
+               int K,
+               int derivativeOrder);
+
+    /* Calculates the product of the transpose of the matrix and the matrix
+    itself. The result is a band matrix with bandwidth m-1, or 'bandwidth' if
+    it is larger, so that it can be summed with a wider penalty matrix */
+    void transposeTimesItself(BandMatrix& FiTFi, int bandwidth = 0) const;
+
+    /* Calculates the product of the transpose of the matrix and vector y */
+    void transposeTimes(const vector<double>& y, vector<double>& FiTy) const;
+
+    /* Calculates the product of the matrix and vector c */
+    void times(const vector<double>& c, vector<double>& Fic) const;
+
+    /* Memory reserved by the vectors of the matrix, in bytes. It is kept when
+    the matrix is built again with a smaller or equal number of rows */
+    size_t reservedBytes() const;
+
+////////////////////////////////////////////////////////////////////////////////
+
+private:
+
+    /* Powers of the abscissa of the current row */
+    vector<double> powers;
+
+};
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+
+
+void DesignMatrix::build(const vector<double>& abscissae,
+                         const vector<double>& knotsForCalculations,
+                         const BasisFunctions& basisFunctions,
+                         int numberOfBasisFunctions,
+                         int derivativeOrder) {
+
+    n = abscissae.size();
+    K = numberOfBasisFunctions;
+    m = knotsForCalculations.size() - K;
+    int g = m - 1;
+
+    // Index in knotsForCalculations of the last real knot
+    int lastRealKnot = knotsForCalculations.size() - m;
+
+    firstColumn.assign(n,0);
+    values.assign(n*m,0);
+
+    powers.assign(m,1);
+
+    for (int i=0; i<n; ++i) {
+
+        double x = abscissae[i];
+
+        // Finds q such that knotsForCalculations[q] <= x <
+        // knotsForCalculations[q+1]. The basis functions q-g, ..., q are the
+        // only ones which can be non-zero at x, and basis function j is
+        // described by its polynomial q-j
+        int q = upper_bound(knotsForCalculations.begin()+g,
+                            knotsForCalculations.begin()+lastRealKnot+1,
+                            x) - knotsForCalculations.begin() - 1;
+
+        // At the last real knot the rightmost basis function does not exist,
+        // so the row is shifted to remain inside the matrix
+        int first = min(q-g,K-m);
+        firstColumn[i] = first;
+
+        // Calculates the powers of x
+        for (int a=1; a<m; ++a)
+            powers[a] = powers[a-1]*x;
+
+        for (int c=0; c<m; ++c) {
+            int j = first + c;
+            int indexOfPolynomial = q - j;
+            if (indexOfPolynomial < 0 || indexOfPolynomial > g)
+                continue;
+            double y = 0;
+            if (derivativeOrder == 0)
+                for (int a=0; a<m; ++a)
+                    y += basisFunctions.coeffD0(j,indexOfPolynomial)[a]*
+                         powers[a];
+            else
+                for (int a=0; a<g; ++a)
+                    y += basisFunctions.coeffD1(j,indexOfPolynomial)[a]*
+                         powers[a];
+            values[i*m+c] = y;
+        }
+
+    }
+
+}
+
+
+
+void DesignMatrix::transposeTimesItself(BandMatrix& FiTFi,
+                                        int bandwidth) const {
+
+    FiTFi.resize(K,max(m-1,bandwidth));
+
+    for (int i=0; i<n; ++i) {
+        const double* row = &values[i*m];
+        int first = firstColumn[i];
+        for (int a=0; a<m; ++a)
+            for (int b=0; b<=a; ++b)
+                FiTFi(first+a,first+b) += row[a] * row[b];
+    }
+
+}
+
+
+
+void DesignMatrix::transposeTimes(const vector<double>& y,
+                                  vector<double>& FiTy) const {
+
+    FiTy.assign(K,0);
+
+    for (int i=0; i<n; ++i)
+        for (int c=0; c<m; ++c)
+            FiTy[firstColumn[i]+c] += values[i*m+c] * y[i];
+
+}
+
+
+
+void DesignMatrix::times(const vector<double>& c, vector<double>& Fic) const {
+
+    Fic.assign(n,0);
+
+    for (int i=0; i<n; ++i)
+        for (int a=0; a<m; ++a)
+            Fic[i] += values[i*m+a] * c[firstColumn[i]+a];
+
+}
+
+
+
+size_t DesignMatrix::reservedBytes() const {
+
+    return firstColumn.capacity()*sizeof(int) +
+           (values.capacity()+powers.capacity())*sizeof(double);
+
+}
@@ -0,0 +1,378 @@
+
+/* Matrices used while calculating GCV1 for a single value of lambda */
+struct GCV1Workspace {
+
+    /* Sum of FiTFi and the product of lambda and R, replaced by its LDLT
+    decomposition */
+    BandMatrix M;
+
+    /* Elements of the inverse of M inside the band of M */
+    BandMatrix Minv;
+
+    /* First derivative of the spline at the abscissae */
+    vector<double> splineD1;
+
+    /* Spline coefficients for the current value of lambda */
+    vector<double> coefficients;
+
+    /* Trace of matrix S for the current value of lambda */
+    double traceS;
+
+    /* Values of GCV1 on the grid of values of lambda. Used by the thread
+    calling minimizeGCV1OnGrid() */
+    vector<double> GCV1ForVariousLambdas;
+
+    /* Spline coefficients on the grid of values of lambda, one set after the
+    other. Used by the thread calling minimizeGCV1OnGrid() */
+    vector<double> coefficientsForVariousLambdas;
+
+    /* Traces of matrix S on the grid of values of lambda. Used by the thread
+    calling minimizeGCV1OnGrid() */
+    vector<double> traceSForVariousLambdas;
+
+    /* Threads sharing the grid of values of lambda with the thread calling
+    minimizeGCV1OnGrid(), and their workspaces, one for each thread but the
+    calling one. They are kept from one fit to the next */
+    unique_ptr<ThreadPool> threadPool;
+    vector<GCV1Workspace> threadWorkspaces;
+
+    ////////////////////////////////////////////////////////////////////////////
+
+    /* Memory reserved by the matrices and vectors, including those of
+    threadWorkspaces, in bytes */
+    size_t reservedBytes() const;
+
+};
+
+
+
+size_t GCV1Workspace::reservedBytes() const {
+
+    size_t bytes = M.reservedBytes() + Minv.reservedBytes();
+    bytes += (splineD1.capacity() + coefficients.capacity() +
+              GCV1ForVariousLambdas.capacity() +
+              coefficientsForVariousLambdas.capacity() +
+              traceSForVariousLambdas.capacity())*sizeof(double);
+    bytes += threadWorkspaces.capacity()*sizeof(GCV1Workspace);
+    for (const auto& threadWorkspace : threadWorkspaces)
+        bytes += threadWorkspace.reservedBytes();
+
+    return bytes;
+
+}
+
+
+
+/* Best value of GCV1 found while minimizing it with respect to log10lambda */
+struct GCV1Minimum {
+
+    /* Value of log10lambda corresponding to the minimum */
+    double log10lambda;
+
+    /* Value of GCV1 at the minimum */
+    double GCV1;
+
+    /* Spline coefficients corresponding to the minimum */
+    vector<double> coefficients;
+
+    /* Trace of matrix S corresponding to the minimum, equal to the effective
+    degrees of freedom of the spline */
+    double traceS;
+
+    /* Number of values of lambda for which GCV1 was calculated */
+    int numberOfEvaluations;
+
+};
+
+
+
+class GCV1Function {
+
+public:
+
+    /* Product of the transpose of the Fi matrix and the Fi matrix */
+    const BandMatrix* FiTFi;
+
+    /* Matrix of the integrals of the products of the second derivatives of
+    the basis functions */
+    const BandMatrix* R;
+
+    /* Product of the transpose of the Fi matrix and the ordinates */
+    const vector<double>* FiTy;
+
+    /* Matrix of the first derivatives of the basis functions at the abscissae
+    */
+    const DesignMatrix* FiD1;
+
+    /* Estimated first derivatives of the data. Contains an additional 0 at
+    position 0 */
+    const vector<double>* estimatedD1;
+
+    /* Number of data points */
+    int n;
+
+    /* Demmler-Reinsch basis of FiTFi and R. If it is not null, it is used in
+    place of the factorization of M */
+    const DemmlerReinsch* demmlerReinsch = nullptr;
+
+    ////////////////////////////////////////////////////////////////////////////
+
+    /* Calculates GCV1 for lambda = 10^log10lambda, and saves the corresponding
+    spline coefficients in 'coefficients' and the trace of matrix S in
+    workspace.traceS */
+    double operator()(double log10lambda,
+                      GCV1Workspace& workspace,
+                      vector<double>& coefficients) const;
+
+};
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+
+
+double GCV1Function::operator()(double log10lambda,
+                                GCV1Workspace& workspace,
+                                vector<double>& coefficients) const {
+
+    double lambda = pow(10., log10lambda);
+
+    double& traceS = workspace.traceS;
+
+    if (demmlerReinsch) {
+
+        // Calculates the spline coefficients and the trace of matrix S from
+        // the diagonal form of M. The cost is proportional to K*K
+        demmlerReinsch->coefficients(lambda, coefficients);
+        traceS = demmlerReinsch->traceS(lambda);
+
+    }
+    else {
+
+        BandMatrix& M = workspace.M;
+        BandMatrix& Minv = workspace.Minv;
+
+        // Calculates the M matrix, sum of FiTFi and the product of Lambda and
+        // R
+        M.resize(FiTFi->K,FiTFi->bandwidth);
+        M.sum(*FiTFi, lambda, *R);
+
+        // Uses the LDLT decomposition to decompose M, and saves the values of
+        // the D and L matrices in place of the band of M. The cost is
+        // proportional to K*g*g
+        M.factorize();
+
+        // Calculates the spline coefficients from M*coefficients = FiTy
+        coefficients = *FiTy;
+        M.solve(coefficients);
+
+        // Calculates the elements of Minv inside the band of M, the only ones
+        // needed for the trace of S
+        M.selectedInverse(Minv);
+
+        // Calculates the trace of matrix S = Fi*Minv*FiT, equal to the trace
+        // of Minv*FiTFi
+        traceS = Minv.traceOfProduct(*FiTFi);
+
+    }
+
+    // Calculates the first derivative of the spline at the abscissae. Each row
+    // of FiD1 has at most m non-zero elements, so the cost is proportional to
+    // n*m
+    FiD1->times(coefficients, workspace.splineD1);
+
+    // Calculates the numerator of GCV1(Lambda)
+    double SSE1 = 0; // Sum of squared errors between yi' and f'(xi)
+    for (int i=1; i<n-1; ++i) {
+        double difference = (*estimatedD1)[i] - workspace.splineD1[i];
+        SSE1 += difference * difference;
+    }
+
+    // Calculates GCV1(Lambda)
+    return (double)n * SSE1 / (((double)n-traceS)*((double)n-traceS));
+
+}
+
+
+
+/* Calculates GCV1 for numberOfSteps equally spaced values of log10lambda,
+starting from log10lambdaMin, and saves the first minimum in 'minimum'. The
+values of lambda are shared among numberOfThreads threads, each with its own
+workspace, the calling thread using 'workspace'. The other threads and their
+workspaces are kept in 'workspace'. The result does not depend on the number
+of threads */
+void minimizeGCV1OnGrid(const GCV1Function& GCV1,
+                        double log10lambdaMin,
+                        double log10lambdaStep,
+                        int numberOfSteps,
+                        int numberOfThreads,
+                        GCV1Workspace& workspace,
+                        GCV1Minimum& minimum) {
+
+    int K = GCV1.FiTFi->K;
+
+    vector<double>& GCV1ForVariousLambdas = workspace.GCV1ForVariousLambdas;
+    vector<double>& coefficientsForVariousLambdas =
+        workspace.coefficientsForVariousLambdas;
+    vector<double>& traceSForVariousLambdas = workspace.traceSForVariousLambdas;
+    GCV1ForVariousLambdas.assign(numberOfSteps,0);
+    coefficientsForVariousLambdas.resize(numberOfSteps*K);
+    traceSForVariousLambdas.assign(numberOfSteps,0);
+
+    // Calculates GCV1 for the steps first, first+numberOfThreads, ...
+    auto calculateSteps = [&](int first, GCV1Workspace& threadWorkspace) {
+        for (int a=first; a<numberOfSteps; a+=numberOfThreads) {
+            GCV1ForVariousLambdas[a] =
+                GCV1(log10lambdaMin + (double)a * log10lambdaStep,
+                     threadWorkspace,
+                     threadWorkspace.coefficients);
+            copy(threadWorkspace.coefficients.begin(),
+                 threadWorkspace.coefficients.end(),
+                 coefficientsForVariousLambdas.begin() + a*K);
+            traceSForVariousLambdas[a] = threadWorkspace.traceS;
+        }
+    };
+
+    numberOfThreads = max(1,min(numberOfThreads,numberOfSteps));
+
+    // Task t calculates the steps t, t+numberOfThreads, ... with workspace t,
+    // whichever thread of the pool runs it
+    ThreadPool& pool = reusableThreadPool(workspace.threadPool, numberOfThreads);
+    if ((int)workspace.threadWorkspaces.size() < numberOfThreads-1)
+        workspace.threadWorkspaces.resize(numberOfThreads-1);
+    pool.run(numberOfThreads, [&](int t) {
+        calculateSteps(t, t == 0 ? workspace : workspace.threadWorkspaces[t-1]);
+    });
+
+    // Finds the first minimum value of GCV1(lambda)
+    int index = 0;
+    for (int a=1; a<numberOfSteps; ++a)
+        if (GCV1ForVariousLambdas[a] < GCV1ForVariousLambdas[index])
+            index = a;
+
+    minimum.log10lambda = log10lambdaMin + (double)index * log10lambdaStep;
+    minimum.GCV1 = GCV1ForVariousLambdas[index];
+    minimum.coefficients.assign(coefficientsForVariousLambdas.begin() + index*K,
+                                coefficientsForVariousLambdas.begin() + (index+1)*K);
+    minimum.traceS = traceSForVariousLambdas[index];
+    minimum.numberOfEvaluations = numberOfSteps;
+
+}
+
+
+
+/* Refines a minimum found on a grid with step log10lambdaStep using Brent's
+method, inside the interval delimited by the two neighbouring grid points and
+the ends of the grid. Stops when the minimum is located within 'tolerance'
+on log10lambda or after maximumEvaluations further calculations of GCV1 */
+void refineGCV1WithBrent(const GCV1Function& GCV1,
+                         double log10lambdaMin,
+                         double log10lambdaMax,
+                         double log10lambdaStep,
+                         double tolerance,
+                         int maximumEvaluations,
+                         GCV1Workspace& workspace,
+                         GCV1Minimum& minimum) {
+
+    // Golden section ratio, and relative precision on log10lambda
+    const double goldenRatio = 0.5*(3.-sqrt(5.));
+    const double epsilon = sqrt(numeric_limits<double>::epsilon());
+
+    double a = max(log10lambdaMin, minimum.log10lambda-log10lambdaStep);
+    double b = min(log10lambdaMax, minimum.log10lambda+log10lambdaStep);
+
+    // x: best point so far; w: second best point; v: previous value of w
+    double x = minimum.log10lambda;
+    double w = x;
+    double v = x;
+    double fx = minimum.GCV1;
+    double fw = fx;
+    double fv = fx;
+
+    double d = 0; // Current step
+    double e = 0; // Step before the previous one
+
+    vector<double>& coefficients = workspace.coefficients;
+
+    for (int evaluations=0; evaluations<maximumEvaluations; ++evaluations) {
+
+        double middle = 0.5*(a+b);
+        double tolerance1 = epsilon*fabs(x) + tolerance/3.;
+        double tolerance2 = 2.*tolerance1;
+
+        if (fabs(x-middle) <= tolerance2-0.5*(b-a))
+            break;
+
+        // Tries a parabolic step through x, w and v, and falls back on a
+        // golden section step if the parabola is not acceptable
+        bool goldenSection = true;
+        if (fabs(e) > tolerance1) {
+            double r = (x-w)*(fx-fv);
+            double q = (x-v)*(fx-fw);
+            double p = (x-v)*q-(x-w)*r;
+            q = 2.*(q-r);
+            if (q > 0)
+                p = -p;
+            else
+                q = -q;
+            double eOld = e;
+            e = d;
+            if (fabs(p) < fabs(0.5*q*eOld) && p > q*(a-x) && p < q*(b-x)) {
+                d = p/q;
+                double u = x+d;
+                if (u-a < tolerance2 || b-u < tolerance2)
+                    d = x < middle ? tolerance1 : -tolerance1;
+                goldenSection = false;
+            }
+        }
+        if (goldenSection) {
+            e = x < middle ? b-x : a-x;
+            d = goldenRatio*e;
+        }
+
+        // GCV1 is never calculated closer than tolerance1 to x
+        double u = fabs(d) >= tolerance1 ?
+                   x+d : x+(d > 0 ? tolerance1 : -tolerance1);
+        double fu = GCV1(u, workspace, coefficients);
+        ++minimum.numberOfEvaluations;
+
+        if (fu <= fx) {
+            if (u < x)
+                b = x;
+            else
+                a = x;
+            v = w;
+            fv = fw;
+            w = x;
+            fw = fx;
+            x = u;
+            fx = fu;
+            minimum.coefficients.swap(coefficients);
+            minimum.traceS = workspace.traceS;
+        }
+        else {
+            if (u < x)
+                a = u;
+            else
+                b = u;
+            if (fu <= fw || w == x) {
+                v = w;
+                fv = fw;
+                w = u;
+                fw = fu;
+            }
+            else if (fu <= fv || v == x || v == w) {
+                v = u;
+                fv = fu;
+            }
+        }
+
+    }
+
+    minimum.log10lambda = x;
+    minimum.GCV1 = fx;
+
+}
@@ -0,0 +1,59 @@
+
+/* Function evaluating at x the polynomial of the given degree whose
+coefficients, from the constant term up, are saved in 'coefficients' */
+typedef double (*HornerKernel)(const double* coefficients, int degree, double x);
+
+/* Highest degree for which a kernel specialized on the degree exists */
+const int maximumKernelDegree = 6;
+
+
+
+/* Evaluates the polynomial of degree Degree with Horner's method. The number
+of iterations is known at compile time, so the loop is unrolled. The degree
+argument of HornerKernel is not used */
+template<int Degree>
+double horner(const double* coefficients, int /*degree*/, double x) {
+
+    double y = coefficients[Degree];
+    for (int a=Degree-1; a>=0; --a)
+        y = y*x + coefficients[a];
+
+    return y;
+
+}
+
+
+
+/* Evaluates the polynomial of degree 'degree' with Horner's method, for any
+degree. Polynomials of negative degree, such as the second derivative of a
+polynomial of degree 1, are equal to 0 */
+double hornerAnyDegree(const double* coefficients, int degree, double x) {
+
+    if (degree < 0)
+        return 0;
+
+    double y = coefficients[degree];
+    for (int a=degree-1; a>=0; --a)
+        y = y*x + coefficients[a];
+
+    return y;
+
+}
+
+
+
+/* Returns the kernel evaluating polynomials of the given degree */
+HornerKernel hornerKernel(int degree) {
+
+    switch (degree) {
+        case 0: return &horner<0>;
+        case 1: return &horner<1>;
+        case 2: return &horner<2>;
+        case 3: return &horner<3>;
+        case 4: return &horner<4>;
+        case 5: return &horner<5>;
+        case 6: return &horner<6>;
+        default: return &hornerAnyDegree;
+    }
+
+}
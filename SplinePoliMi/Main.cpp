@@ -3,12 +3,34 @@
 #include <algorithm>
 #include <random>
 #include <iomanip>
+#include <limits>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <exception>
+#include <memory>
+#include <numeric>
+#include <cstring>
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#endif
 
 using namespace std;
 
 #include "Settings.h"
+#include "BandMatrix.h"
+#include "Horner.h"
+#include "SplineEvaluation.h"
+#include "Bernstein.h"
+#include "SplineAnalysis.h"
 #include "BasisFunction.h"
+#include "DesignMatrix.h"
 #include "Utilities.h"
+#include "DemmlerReinsch.h"
+#include "ThreadPool.h"
+#include "GCV1.h"
+#include "SplineWorkspace.h"
 #include "Spline.h"
 #include "ComputeSpline.h"
 
@@ -64,8 +86,82 @@ spline di grado maggiore di 3
 */
 
 
+/* Builds the settings of a fit from the arguments of the C functions, and
+saves them in 'settings'. Returns false if the arguments cannot describe a fit:
+if there are no candidate splines, or if lambdaOptimizer_, solver_ or penalty_
+is not one of the names in Settings.h */
+bool makeSettings(int g_, int lambdaSearchInterval_, int numberOfStepsLambda_, int numberOfRatiolkForAICcUse_,
+            double fractionOfOrdinateRangeForAsymptoteIdentification_,
+            double fractionOfOrdinateRangeForMaximumIdentification_,
+            int graphPoints_, char* criterion_,
+            char* lambdaOptimizer_, double lambdaTolerance_,
+            int maximumLambdaEvaluations_, int numberOfStepsLambdaBracket_,
+            char* solver_,
+            char* penalty_, int differenceOrder_,
+            int numberOfThreadsLambda_,
+            int* numberOfAbscissaeSeparatingConsecutiveKnots_,
+            int numberOfCandidates_, int numberOfThreadsCandidates_,
+            Settings& settings){
+
+    // calculateSplines() needs at least one candidate, otherwise there is no
+    // best spline to return
+    if (numberOfCandidates_ < 1 || numberOfAbscissaeSeparatingConsecutiveKnots_ == nullptr)
+        return false;
+
+    // The names are parsed once here, so that the fit only compares enums
+    int lambdaOptimizer = indexOfName(lambdaOptimizer_, lambdaOptimizerNames, 2);
+    int solver = indexOfName(solver_, solverNames, 2);
+    int penalty = indexOfName(penalty_, penaltyNames, 2);
+    if (lambdaOptimizer < 0 || solver < 0 || penalty < 0)
+        return false;
+
+    settings.setDegree(g_);
+    settings.lambdaSearchInterval = lambdaSearchInterval_;
+    settings.numberOfStepsLambda = numberOfStepsLambda_;
+    settings.numberOfRatiolkForAICcUse = numberOfRatiolkForAICcUse_;
+    settings.fractionOfOrdinateRangeForAsymptoteIdentification = fractionOfOrdinateRangeForAsymptoteIdentification_;
+    settings.fractionOfOrdinateRangeForMaximumIdentification = fractionOfOrdinateRangeForMaximumIdentification_;
+    settings.graphPoints = graphPoints_;
+    settings.criterion = string(criterion_);
+    settings.lambdaOptimizer = (LambdaOptimizer)lambdaOptimizer;
+    settings.lambdaTolerance = lambdaTolerance_;
+    settings.maximumLambdaEvaluations = maximumLambdaEvaluations_;
+    settings.numberOfStepsLambdaBracket = numberOfStepsLambdaBracket_;
+    settings.solver = (Solver)solver;
+    settings.penalty = (Penalty)penalty;
+    settings.differenceOrder = differenceOrder_;
+    settings.numberOfThreadsLambda = numberOfThreadsLambda_;
+    settings.numberOfAbscissaeSeparatingConsecutiveKnots = vector<int>(
+        numberOfAbscissaeSeparatingConsecutiveKnots_,
+        numberOfAbscissaeSeparatingConsecutiveKnots_ + numberOfCandidates_);
+    settings.numberOfThreadsCandidates = numberOfThreadsCandidates_;
+
+    return true;
+}
+
+/* Copies the knots and the coefficients of the spline to the output arrays.
+The coefficients are saved polynomial by polynomial, m for each polynomial */
+void passBackSpline(const Spline& spline,
+            double* coeffDO, double* coeffD1, double* coeffD2, double* knots){
+
+    for(int i = 0; i < (int)spline.coeffD0.size(); i++){
+        for(int j = 0; j < (int)spline.coeffD0[i].size(); j++){
+            coeffDO[i * spline.coeffD0[i].size() + j] = spline.coeffD0[i][j];
+            coeffD1[i * spline.coeffD0[i].size() + j] = spline.coeffD1[i][j];
+            coeffD2[i * spline.coeffD0[i].size() + j] = spline.coeffD2[i][j];
+        }
+    }
+
+    for(int i = 0; i < (int)spline.knots.size(); i++){
+        knots[i] = spline.knots[i];
+    }
+}
+
 /*
     x and y have to be sorted and without duplicates on the x-axis.
+    The function does not use any global state, so it can be called
+    concurrently from different threads. Returns 1, without calculating the
+    spline, if the settings are invalid (see makeSettings), 0 otherwise.
 */
 extern "C"
 int compute_spline_cpp(double* x, double* y, int length, int splineType,
@@ -75,7 +171,15 @@ int compute_spline_cpp(double* x, double* y, int length, int splineType,
             int g_, int lambdaSearchInterval_, int numberOfStepsLambda_, int numberOfRatiolkForAICcUse_,
             double fractionOfOrdinateRangeForAsymptoteIdentification_,
             double fractionOfOrdinateRangeForMaximumIdentification_,
-            int graphPoints_, char* criterion_){
+            int graphPoints_, char* criterion_,
+            char* lambdaOptimizer_, double lambdaTolerance_,
+            int maximumLambdaEvaluations_, int numberOfStepsLambdaBracket_,
+            char* solver_,
+            char* penalty_, int differenceOrder_,
+            int numberOfThreadsLambda_,
+            int* numberOfAbscissaeSeparatingConsecutiveKnots_,
+            int numberOfCandidates_, int numberOfThreadsCandidates_,
+            int* numberOfLambdaEvaluations){
 
 
     // ----------  SET VARIABLE  ----------
@@ -86,24 +190,31 @@ int compute_spline_cpp(double* x, double* y, int length, int splineType,
 
     // ----------  SET SETTINGS  ----------
 
-    g = g_;
-    m = g + 1;
-    lambdaSearchInterval = lambdaSearchInterval_;
-    numberOfStepsLambda = numberOfStepsLambda_;
-    numberOfRatiolkForAICcUse = numberOfRatiolkForAICcUse_;
-    fractionOfOrdinateRangeForAsymptoteIdentification = fractionOfOrdinateRangeForAsymptoteIdentification_;
-    fractionOfOrdinateRangeForMaximumIdentification = fractionOfOrdinateRangeForMaximumIdentification_;
-    graphPoints = graphPoints_;
-    criterion = string(criterion_);
+    // The settings are local to this call, so that fits running concurrently
+    // in different threads do not interfere
+    Settings settings;
+    if (!makeSettings(g_, lambdaSearchInterval_, numberOfStepsLambda_, numberOfRatiolkForAICcUse_,
+            fractionOfOrdinateRangeForAsymptoteIdentification_,
+            fractionOfOrdinateRangeForMaximumIdentification_,
+            graphPoints_, criterion_,
+            lambdaOptimizer_, lambdaTolerance_,
+            maximumLambdaEvaluations_, numberOfStepsLambdaBracket_,
+            solver_,
+            penalty_, differenceOrder_,
+            numberOfThreadsLambda_,
+            numberOfAbscissaeSeparatingConsecutiveKnots_,
+            numberOfCandidates_, numberOfThreadsCandidates_,
+            settings))
+        return 1;
 
 
     // ----------  COMPUTE BEST SPLINE  ----------
 
-    vector<Spline> possibleSplines = calculateSplines(x_vector, y_vector, splineType);
+    vector<Spline> possibleSplines = calculateSplines(x_vector, y_vector, splineType, settings);
 
-    int index_best = calculateBestSpline(possibleSplines, criterion);
+    int index_best = calculateBestSpline(possibleSplines, settings);
 
-    Spline best_spline = possibleSplines[index_best];
+    const Spline& best_spline = possibleSplines[index_best];
 
 
     // ---------- VERBOSE ----------
@@ -118,9 +229,9 @@ int compute_spline_cpp(double* x, double* y, int length, int splineType,
         cout << endl;
 
         cout << "Spline X: ";
-        printV_inLine(best_spline.abscissae);
+        printV_inLine(best_spline.data->abscissae);
         cout << "Spline Y: ";
-        printV_inLine(best_spline.ordinates);
+        printV_inLine(best_spline.data->ordinates);
         cout << endl;
 
         cout << "KNOTS: ";
@@ -134,26 +245,26 @@ int compute_spline_cpp(double* x, double* y, int length, int splineType,
         cout << "CoeffD2:" << endl;
         printM(best_spline.coeffD2);
         cout << "SETTINGS:" << endl;
-        printSettings();
+        printSettings(settings);
 
         cout << endl;
 
         cout << "D0:" << endl;
-        tmp = evaluateSpline(best_spline, 0);
+        tmp = evaluateSpline(best_spline, 0, settings.graphPoints);
         cout << "\tx: ";
         printV_inLine(tmp[0]);
         cout << "\ty: ";
         printV_inLine(tmp[1]);
 
         cout << "D1:" << endl;
-        tmp = evaluateSpline(best_spline, 1);
+        tmp = evaluateSpline(best_spline, 1, settings.graphPoints);
         cout << "\tx: ";
         printV_inLine(tmp[0]);
         cout << "\ty: ";
         printV_inLine(tmp[1]);
 
         cout << "D2:" << endl;
-        tmp = evaluateSpline(best_spline, 2);
+        tmp = evaluateSpline(best_spline, 2, settings.graphPoints);
         cout << "\tx: ";
         printV_inLine(tmp[0]);
         cout << "\ty: ";
@@ -165,25 +276,452 @@ int compute_spline_cpp(double* x, double* y, int length, int splineType,
 
     *numberOfKnots = best_spline.knots.size();
     *numberOfPolynomials = best_spline.numberOfPolynomials;
+    *numberOfLambdaEvaluations = best_spline.numberOfLambdaEvaluations;
+
+    passBackSpline(best_spline, coeffDO, coeffD1, coeffD2, knots);
+
+    possibleSplines.clear();
+    possibleSplines.shrink_to_fit();
+
+    return 0;
+}
+
+/* Status codes of compute_splines_batch, one for each curve */
+enum CurveStatus {
+    curveFitted = 0,       // The spline was calculated
+    curveTooShort = 1,     // Less than 2 data points
+    curveInvalidData = 2,  // Non-finite values, abscissae not strictly
+                           // increasing or unknown splineType
+    curveOutputTooSmall = 3, // The knots do not fit in the space reserved
+                             // for the curve in the output arrays
+    curveFailed = 4        // Unexpected error while calculating the spline
+};
+
+/*
+    Calculates the splines of numberOfCurves curves with the same settings.
+    The data points of curve i are x[offsets[i]], ..., x[offsets[i+1]-1] and
+    the corresponding elements of y, sorted and without duplicates on the
+    x-axis, and its type is splineTypes[i].
+
+    The knots of curve i are saved in knots starting from knotsOffsets[i], and
+    at most knotsOffsets[i+1]-knotsOffsets[i] of them can be saved. Its
+    coefficients are saved in coeffD0, coeffD1 and coeffD2 starting from
+    knotsOffsets[i]*(g+1), with g+1 coefficients for each polynomial. The output
+    arrays must then contain knotsOffsets[numberOfCurves] knots and
+    knotsOffsets[numberOfCurves]*(g+1) coefficients.
+
+    The curves are shared among numberOfThreads threads, starting from the
+    longest ones, and the candidate splines and the values of lambda of each
+    curve are calculated serially. A curve which cannot be calculated does not
+    stop the others: its status is saved in status[i], and the function
+    returns the number of curves with status different from curveFitted. If
+    the knots do not fit, numberOfKnots[i] still contains the number of knots
+    of the spline. If the settings are invalid (see makeSettings), or offsets
+    and knotsOffsets do not start from 0 or decrease, the function returns -1
+    without calculating any curve or setting any status.
+*/
+extern "C"
+int compute_splines_batch(int numberOfCurves,
+            double* x, double* y, int* offsets, int* splineTypes,
+            int* knotsOffsets,
+            int* numberOfKnots, int* numberOfPolynomials,
+            double* coeffDO, double* coeffD1, double* coeffD2, double* knots,
+            int* numberOfLambdaEvaluations, int* status,
+            int numberOfThreads,
+            int g_, int lambdaSearchInterval_, int numberOfStepsLambda_, int numberOfRatiolkForAICcUse_,
+            double fractionOfOrdinateRangeForAsymptoteIdentification_,
+            double fractionOfOrdinateRangeForMaximumIdentification_,
+            int graphPoints_, char* criterion_,
+            char* lambdaOptimizer_, double lambdaTolerance_,
+            int maximumLambdaEvaluations_, int numberOfStepsLambdaBracket_,
+            char* solver_,
+            char* penalty_, int differenceOrder_,
+            int* numberOfAbscissaeSeparatingConsecutiveKnots_,
+            int numberOfCandidates_){
+
 
-    for(int i = 0; i < (int)best_spline.coeffD0.size(); i++){
-        for(int j = 0; j < (int)best_spline.coeffD0[i].size(); j++){
-            coeffDO[i * best_spline.coeffD0[i].size() + j] = best_spline.coeffD0[i][j];
-            coeffD1[i * best_spline.coeffD0[i].size() + j] = best_spline.coeffD1[i][j];
-            coeffD2[i * best_spline.coeffD0[i].size() + j] = best_spline.coeffD2[i][j];
+    // ----------  SET SETTINGS  ----------
+
+    Settings settings;
+    if (!makeSettings(g_, lambdaSearchInterval_, numberOfStepsLambda_, numberOfRatiolkForAICcUse_,
+            fractionOfOrdinateRangeForAsymptoteIdentification_,
+            fractionOfOrdinateRangeForMaximumIdentification_,
+            graphPoints_, criterion_,
+            lambdaOptimizer_, lambdaTolerance_,
+            maximumLambdaEvaluations_, numberOfStepsLambdaBracket_,
+            solver_,
+            penalty_, differenceOrder_,
+            1 /*numberOfThreadsLambda*/,
+            numberOfAbscissaeSeparatingConsecutiveKnots_,
+            numberOfCandidates_, 1 /*numberOfThreadsCandidates*/,
+            settings))
+        return -1;
+
+    // A decreasing offset would give a negative length to a curve, or make
+    // two curves write in the same part of the output arrays
+    if (numberOfCurves < 0 || offsets[0] != 0 || knotsOffsets[0] != 0)
+        return -1;
+    for (int i = 0; i < numberOfCurves; i++)
+        if (offsets[i+1] < offsets[i] || knotsOffsets[i+1] < knotsOffsets[i])
+            return -1;
+
+
+    // ----------  COMPUTE THE SPLINES  ----------
+
+    // The longest curves are calculated first, so that the threads do not
+    // wait for a long curve taken at the end of the batch
+    vector<int> order(numberOfCurves);
+    for (int i = 0; i < (int)order.size(); i++)
+        order[i] = i;
+    stable_sort(order.begin(), order.end(), [&](int a, int b){
+        return offsets[a+1] - offsets[a] > offsets[b+1] - offsets[b];
+    });
+
+    auto computeCurve = [&](int task){
+
+        int i = order[task];
+        int first = offsets[i];
+        int length = offsets[i+1] - offsets[i];
+
+        numberOfKnots[i] = 0;
+        numberOfPolynomials[i] = 0;
+        numberOfLambdaEvaluations[i] = 0;
+
+        if (length < 2){
+            status[i] = curveTooShort;
+            return;
         }
-    }
 
-    for(int i = 0; i < (int)best_spline.knots.size(); i++){
-        knots[i] = best_spline.knots[i];
+        bool validData = splineTypes[i] == 0 || splineTypes[i] == 1;
+        for (int a = first; a < first + length && validData; a++){
+            if (!isfinite(x[a]) || !isfinite(y[a]))
+                validData = false;
+            else if (a > first && !(x[a] > x[a-1]))
+                validData = false;
+        }
+        if (!validData){
+            status[i] = curveInvalidData;
+            return;
+        }
+
+        try {
+
+            vector<double> x_vector(x + first, x + first + length);
+            vector<double> y_vector(y + first, y + first + length);
+
+            vector<Spline> possibleSplines =
+                calculateSplines(x_vector, y_vector, splineTypes[i], settings);
+
+            const Spline& best_spline =
+                possibleSplines[calculateBestSpline(possibleSplines, settings)];
+
+            numberOfKnots[i] = best_spline.knots.size();
+
+            if (numberOfKnots[i] > knotsOffsets[i+1] - knotsOffsets[i]){
+                status[i] = curveOutputTooSmall;
+                return;
+            }
+
+            numberOfPolynomials[i] = best_spline.numberOfPolynomials;
+            numberOfLambdaEvaluations[i] = best_spline.numberOfLambdaEvaluations;
+
+            int firstCoefficient = knotsOffsets[i] * settings.m;
+            passBackSpline(best_spline,
+                           coeffDO + firstCoefficient,
+                           coeffD1 + firstCoefficient,
+                           coeffD2 + firstCoefficient,
+                           knots + knotsOffsets[i]);
+
+            status[i] = curveFitted;
+
+        }
+        catch (...) {
+            numberOfKnots[i] = 0;
+            status[i] = curveFailed;
+        }
+
+    };
+
+    // The pool is kept by the calling thread, so that its threads and their
+    // workspaces are reused by the following batches
+    thread_local unique_ptr<ThreadPool> curvesPool;
+    ThreadPool& pool =
+        reusableThreadPool(curvesPool, min(numberOfThreads, numberOfCurves));
+    pool.run(numberOfCurves, computeCurve);
+
+    int numberOfFailures = 0;
+    for (int i = 0; i < numberOfCurves; i++)
+        if (status[i] != curveFitted)
+            numberOfFailures++;
+
+    return numberOfFailures;
+}
+
+/*
+    Returns the counters of the workspaces of all the threads: the number of
+    fits calculated, the number of fits which allocated memory on the heap for
+    their temporaries, the number of those allocations, counted as the members
+    of the workspaces whose reserved memory grew during a fit, and the memory
+    currently reserved by the workspaces, in bytes. Each thread keeps its own workspace, so once the
+    workspaces have grown to the size of the data numberOfFitsWithAllocations
+    stops increasing. The knots and the polynomials of the splines are results,
+    and are not counted.
+*/
+extern "C"
+void spline_workspace_statistics(long* numberOfFits,
+            long* numberOfFitsWithAllocations, long* numberOfAllocations,
+            long* reservedBytes){
+
+    *numberOfFits = workspaceStatistics.numberOfFits;
+    *numberOfFitsWithAllocations = workspaceStatistics.numberOfFitsWithAllocations;
+    *numberOfAllocations = workspaceStatistics.numberOfAllocations;
+    *reservedBytes = workspaceStatistics.reservedBytes;
+}
+
+/*
+    Evaluates a spline, or one of its derivatives, at numberOfPoints abscissae
+    x, and saves the results in y. The polynomials are those returned by
+    compute_spline_cpp: numberOfKnots-1 polynomials, each one with stride
+    coefficients from the constant term up, of which the first degree+1 are
+    used (degree g for coeffD0, g-1 for coeffD1 and g-2 for coeffD2). The
+    abscissae do not need to be sorted, but sorted abscissae are faster.
+    Returns 1 if the spline has less than two knots or if degree is not
+    smaller than stride, 0 otherwise.
+*/
+extern "C"
+int evaluate_spline(double* knots, int numberOfKnots,
+            double* coefficients, int stride, int degree,
+            double* x, int numberOfPoints, double* y){
+
+    if (numberOfKnots < 2 || degree >= stride)
+        return 1;
+
+    evaluatePiecewisePolynomial(knots, numberOfKnots, coefficients, stride,
+                                degree, x, numberOfPoints, y);
+
+    return 0;
+}
+
+/*
+    Evaluates a spline and its first and second derivatives at numberOfPoints
+    equally spaced abscissae start + i*step, i = 0, ..., numberOfPoints-1, and
+    saves the results in d0, d1 and d2, any of which can be null. step can be
+    negative. The polynomials are the coeffD0 returned by compute_spline_cpp,
+    as in evaluate_spline with degree g. Returns 1 if the spline has less than
+    two knots or if degree is negative or not smaller than stride, 0
+    otherwise.
+*/
+extern "C"
+int sample_spline(double* knots, int numberOfKnots,
+            double* coefficients, int stride, int degree,
+            double start, double step, int numberOfPoints,
+            double* d0, double* d1, double* d2){
+
+    if (numberOfKnots < 2 || degree < 0 || degree >= stride)
+        return 1;
+
+    samplePiecewisePolynomial(knots, numberOfKnots, coefficients, stride,
+                              degree, start, step, numberOfPoints, d0, d1, d2);
+
+    return 0;
+}
+
+/*
+    Calculates the real roots of a spline, or of one of its derivatives, with
+    the polynomials given as in evaluate_spline, and saves them in roots,
+    sorted from smallest to largest, and their number in numberOfRoots. Returns
+    1 if the spline has less than two knots, if degree is not smaller than
+    stride or if there are more than maximumNumberOfRoots roots, in which case
+    only the first maximumNumberOfRoots are saved but numberOfRoots still
+    contains the number of roots, 0 otherwise.
+*/
+extern "C"
+int calculate_roots(double* knots, int numberOfKnots,
+            double* coefficients, int stride, int degree,
+            double* roots, int maximumNumberOfRoots, int* numberOfRoots){
+
+    *numberOfRoots = 0;
+
+    if (numberOfKnots < 2 || degree >= stride)
+        return 1;
+
+    vector<double> rootsVector;
+    realRootsOfPiecewisePolynomial(knots, numberOfKnots, coefficients, stride,
+                                   degree, rootsVector);
+
+    *numberOfRoots = rootsVector.size();
+    copy(rootsVector.begin(),
+         rootsVector.begin() + min(*numberOfRoots, maximumNumberOfRoots), roots);
+
+    return (int)rootsVector.size() > maximumNumberOfRoots ? 1 : 0;
+}
+
+/*
+    Sets to 0 the parts of a spline where it is negative, splitting its
+    intervals at the roots. The polynomials, of degree g, and their
+    derivatives are given as the coeffD0, coeffD1 and coeffD2 returned by
+    compute_spline_cpp, and the result is saved in the same format in
+    newKnots, newCoeffD0, newCoeffD1 and newCoeffD2, with its number of knots
+    in newNumberOfKnots. The result has at most (numberOfKnots-1)*(degree+1)+1
+    knots. Returns 1 if the spline has less than two knots, if degree is not
+    smaller than stride or if the result has more than maximumNumberOfKnots
+    knots, in which case nothing is saved but newNumberOfKnots still contains
+    the number of knots of the result, 0 otherwise.
+*/
+extern "C"
+int remove_negative_segments(double* knots, int numberOfKnots,
+            double* coeffD0, double* coeffD1, double* coeffD2,
+            int stride, int degree, int maximumNumberOfKnots,
+            double* newKnots, double* newCoeffD0, double* newCoeffD1,
+            double* newCoeffD2, int* newNumberOfKnots){
+
+    *newNumberOfKnots = 0;
+
+    if (numberOfKnots < 2 || degree >= stride)
+        return 1;
+
+    vector<double> knotsVector, coeffD0Vector, coeffD1Vector, coeffD2Vector;
+    removeNegativeSegments(knots, numberOfKnots, coeffD0, coeffD1, coeffD2,
+                           stride, degree, knotsVector,
+                           coeffD0Vector, coeffD1Vector, coeffD2Vector);
+
+    *newNumberOfKnots = knotsVector.size();
+
+    if (*newNumberOfKnots > maximumNumberOfKnots)
+        return 1;
+    copy(knotsVector.begin(), knotsVector.end(), newKnots);
+    copy(coeffD0Vector.begin(), coeffD0Vector.end(), newCoeffD0);
+    copy(coeffD1Vector.begin(), coeffD1Vector.end(), newCoeffD1);
+    copy(coeffD2Vector.begin(), coeffD2Vector.end(), newCoeffD2);
+
+    return 0;
+}
+
+/*
+    Finds the local maxima and minima of a spline, given as in
+    remove_negative_segments, and saves their abscissae, ordinates and types
+    (0: minimum, 1: maximum, 2: well-defined maximum, whose prominence is at
+    least fractionOfOrdinateRangeForMaximumIdentification times the range of
+    the spline on the y-axis), sorted along the x-axis, and
+    their number in numberOfExtrema. Returns 1 if the spline has less than two
+    knots, if degree is not smaller than stride or if there are more than
+    maximumNumberOfExtrema extrema, in which case only the first
+    maximumNumberOfExtrema are saved but numberOfExtrema still contains the
+    number of extrema, 0 otherwise.
+*/
+extern "C"
+int find_extrema(double* knots, int numberOfKnots,
+            double* coeffD0, double* coeffD1, double* coeffD2,
+            int stride, int degree,
+            double fractionOfOrdinateRangeForMaximumIdentification,
+            int maximumNumberOfExtrema, double* abscissae, double* ordinates,
+            int* types, int* numberOfExtrema){
+
+    *numberOfExtrema = 0;
+
+    if (numberOfKnots < 2 || degree >= stride)
+        return 1;
+
+    vector<Extremum> extrema;
+    findExtrema(knots, numberOfKnots, coeffD0, coeffD1, coeffD2, stride, degree,
+                fractionOfOrdinateRangeForMaximumIdentification, extrema);
+
+    *numberOfExtrema = extrema.size();
+    for (int i=0; i<min(*numberOfExtrema, maximumNumberOfExtrema); ++i) {
+        abscissae[i] = extrema[i].abscissa;
+        ordinates[i] = extrema[i].ordinate;
+        types[i] = extrema[i].wellDefinedMaximum ? 2 : extrema[i].maximum ? 1 : 0;
     }
 
-    possibleSplines.clear();
-    possibleSplines.shrink_to_fit();
+    return (int)extrema.size() > maximumNumberOfExtrema ? 1 : 0;
+}
+
+/*
+    Removes the horizontal asymptotes at the ends of a spline, given as in
+    remove_negative_segments: the leading and trailing intervals inside which
+    the spline stays within a horizontal area as high as
+    fractionOfOrdinateRangeForAsymptoteIdentification times its range on the
+    y-axis. The remaining knots and polynomials are saved in newKnots,
+    newCoeffD0, newCoeffD1 and newCoeffD2, with their number of knots in
+    newNumberOfKnots, which is at most numberOfKnots. A spline which is all
+    asymptote is kept whole. Returns 1 if the spline has less than two knots
+    or if degree is not smaller than stride, 0 otherwise.
+*/
+extern "C"
+int remove_asymptotes(double* knots, int numberOfKnots,
+            double* coeffD0, double* coeffD1, double* coeffD2,
+            int stride, int degree,
+            double fractionOfOrdinateRangeForAsymptoteIdentification,
+            double* newKnots, double* newCoeffD0, double* newCoeffD1,
+            double* newCoeffD2, int* newNumberOfKnots){
+
+    *newNumberOfKnots = 0;
+
+    if (numberOfKnots < 2 || degree >= stride)
+        return 1;
+
+    int firstPolynomial, lastPolynomial;
+    findAsymptotes(knots, numberOfKnots, coeffD0, coeffD1, stride, degree,
+                   fractionOfOrdinateRangeForAsymptoteIdentification,
+                   firstPolynomial, lastPolynomial);
+
+    *newNumberOfKnots = lastPolynomial - firstPolynomial + 2;
+    copy(knots + firstPolynomial, knots + lastPolynomial + 2, newKnots);
+    copy(coeffD0 + firstPolynomial*stride, coeffD0 + (lastPolynomial+1)*stride, newCoeffD0);
+    copy(coeffD1 + firstPolynomial*stride, coeffD1 + (lastPolynomial+1)*stride, newCoeffD1);
+    copy(coeffD2 + firstPolynomial*stride, coeffD2 + (lastPolynomial+1)*stride, newCoeffD2);
 
     return 0;
 }
 
+/*
+    Calculates the L2 distances between two splines, typically an experimental
+    one (A) and a model (B), and between their first derivatives, on the
+    intersection of their domains. Each spline is given as in
+    remove_negative_segments, and the two can have different knots and
+    degrees. normalization is "none", "reference" (both splines are divided by
+    the largest absolute ordinate of A on the intersection) or "individual"
+    (each spline is divided by its own), and the derivatives are divided by the
+    same factors. If divideByDomainLength is true, the integrals are divided by
+    the length of the intersection. The integrals are calculated exactly, and
+    the results are saved in distanceD0 and distanceD1. Returns 1 if a spline
+    has less than two knots, if a degree is not smaller than its stride, if
+    normalization is unknown, if the domains do not intersect or if a spline to
+    be normalized is 0 on the intersection, 0 otherwise.
+*/
+extern "C"
+int spline_distance(double* knotsA, int numberOfKnotsA,
+            double* coeffD0A, double* coeffD1A, int strideA, int degreeA,
+            double* knotsB, int numberOfKnotsB,
+            double* coeffD0B, double* coeffD1B, int strideB, int degreeB,
+            char* normalization_, bool divideByDomainLength,
+            double* distanceD0, double* distanceD1){
+
+    if (numberOfKnotsA < 2 || degreeA >= strideA ||
+        numberOfKnotsB < 2 || degreeB >= strideB)
+        return 1;
+
+    string normalizationName(normalization_);
+    DistanceNormalization normalization;
+    if (normalizationName == "none")
+        normalization = distanceNotNormalized;
+    else if (normalizationName == "reference")
+        normalization = distanceNormalizedByReference;
+    else if (normalizationName == "individual")
+        normalization = distanceNormalizedIndividually;
+    else
+        return 1;
+
+    bool calculated = splineDistance(knotsA, numberOfKnotsA, coeffD0A, coeffD1A,
+                                     strideA, degreeA,
+                                     knotsB, numberOfKnotsB, coeffD0B, coeffD1B,
+                                     strideB, degreeB,
+                                     normalization, divideByDomainLength,
+                                     *distanceD0, *distanceD1);
+
+    return calculated ? 0 : 1;
+}
+
 int main() {
 //    vector<vector<double>> splineD0;
 //    vector<vector<double>> splineD1;
@@ -7,55 +7,186 @@
 #define SPLINE_SETTINGS_H
 
 
-/* Degree of the basis functions */
-int g;
+/* Methods for minimizing GCV1 with respect to the smoothing parameter lambda.
+The names passed by Spline.py are in lambdaOptimizerNames */
+enum LambdaOptimizer {
+    lambdaOptimizerGrid = 0,    // "grid"
+    lambdaOptimizerBrent = 1    // "brent"
+};
+
+/* Methods for calculating the spline coefficients for each value of lambda.
+The names passed by Spline.py are in solverNames */
+enum Solver {
+    solverBanded = 0,           // "banded"
+    solverDemmlerReinsch = 1    // "demmlerReinsch"
+};
+
+/* Penalties on the roughness of the spline. The names passed by Spline.py are
+in penaltyNames */
+enum Penalty {
+    penaltyIntegral = 0,        // "integral"
+    penaltyDifference = 1       // "difference"
+};
+
+const char* const lambdaOptimizerNames[] = {"grid", "brent"};
+const char* const solverNames[] = {"banded", "demmlerReinsch"};
+const char* const penaltyNames[] = {"integral", "difference"};
+
+/* Returns the position of 'name' among the numberOfNames elements of 'names',
+or -1 if it is not one of them or is null */
+int indexOfName(const char* name, const char* const* names, int numberOfNames);
+
+
+
+/* Settings of a single fit. Every call of compute_spline_cpp builds its own
+instance and passes it down to the splines, so that several fits can run at the
+same time in the same process */
+struct Settings {
+
+    /* Degree of the basis functions */
+    int g = 3;
+
+    /* Order of the basis functions */
+    int m = 4;
+
+    /* Orders of magnitude of difference between the smallest and the largest
+    possible value of the smoothing parameter lambda */
+    int lambdaSearchInterval = 6;
+
+    /* Number of steps in the for cycle for minimizing the smoothing parameter
+    lambda */
+    int numberOfStepsLambda = 13;
+
+    /* Number of threads among which the steps for minimizing the smoothing
+    parameter lambda are shared */
+    int numberOfThreadsLambda = 1;
 
-/* Order of the basis functions */
-int m;
+    /* Number of data points between consecutive knots for each of the
+    candidate splines among which the best spline is chosen */
+    vector<int> numberOfAbscissaeSeparatingConsecutiveKnots = {0, 2, 5};
 
-/* Orders of magnitude of difference between the smallest and the largest
-possible value of the smoothing parameter lambda */
-int lambdaSearchInterval; // ATTENZIONE PRIMA ERA UN DOUBLE messi cast in Spline.h
+    /* Number of threads calculating the candidate splines concurrently */
+    int numberOfThreadsCandidates = 1;
 
-/* Number of steps in the for cycle for minimizing the smoothing parameter
-lambda */
-int numberOfStepsLambda;
+    /* Maximum ratio between the number of parameters and the number of data
+    points for which AICc is used in place of AIC */
+    int numberOfRatiolkForAICcUse = 40;
 
-/* Number of steps in the for cycle for minimizing the smoothing parameter
-lambda */
-int numberOfRatiolkForAICcUse;
+    /* Method for minimizing GCV1 with respect to the smoothing parameter
+    lambda. Grid: the minimum among numberOfStepsLambda values of log10lambda
+    equally spaced over lambdaSearchInterval; Brent: the minimum on a coarse
+    grid of numberOfStepsLambdaBracket values is refined with Brent's method,
+    between the two neighbouring values of the grid */
+    LambdaOptimizer lambdaOptimizer = lambdaOptimizerGrid;
 
-/* Fraction of the range of a spline on the y-axis for determining which
-segments of the spline count as asymptotes. If the oscillations of the spline
-at one of its extremities are contained within a horizontal area with size
-determined by this value, the corresponding segment is identified as an
-asymptote */
-double fractionOfOrdinateRangeForAsymptoteIdentification;
+    /* Tolerance on log10lambda for the refinement with Brent's method */
+    double lambdaTolerance = 1e-3;
 
-/* Fraction of the range of a spline on the y-axis for determining which points
-count as well-defined maxima. In order to be considered a well-defined maximum,
-a point in a spline must not only have first derivative equal to 0 and negative
-second derivative, it must also be sufficiently distant from the two surrounding
-minima. The minimum admissible distance is determined using this variable */
-double fractionOfOrdinateRangeForMaximumIdentification;
+    /* Maximum number of values of lambda evaluated during the refinement with
+    Brent's method */
+    int maximumLambdaEvaluations = 30;
 
-/* Specifies whether negative segments on the y-axis are admissible for the
-splines or whether they should be replaced with straight lines with ordinate 0
-*/
-//bool possibleNegativeOrdinates;
+    /* Number of values of log10lambda, equally spaced over
+    lambdaSearchInterval, among which Brent's method looks for the bracket of the
+    minimum before refining it. It is smaller than numberOfStepsLambda, since
+    Brent's method does not need a fine grid */
+    int numberOfStepsLambdaBracket = 5;
 
+    /* Method for calculating the spline coefficients and the trace of S for
+    each value of lambda. Banded: LDLT decomposition of the band matrix M,
+    with a cost proportional to K*g*g for each lambda; Demmler-Reinsch: FiTFi
+    and R are diagonalized simultaneously once, with a cost proportional to
+    K*K*K and memory proportional to K*K, after which each value of lambda
+    costs K*K. Since the banded solver costs less for every lambda, the
+    Demmler-Reinsch one is never faster, and is kept for comparison */
+    Solver solver = solverBanded;
 
-/**/
-//bool removeAsymptotes;
+    /* Penalty on the roughness of the spline. Integral: integral of the
+    square of the second derivative; difference: sum of the squares of the
+    differences of order differenceOrder between the coefficients of
+    consecutive basis functions, as in the P-splines of Eilers and Marx */
+    Penalty penalty = penaltyIntegral;
 
-/* Pascal's triangle */
-vector<vector<double>> pascalsTriangle;
+    /* Order of the differences of the difference penalty */
+    int differenceOrder = 2;
 
-/* Number of points to be calculated for each spline when saving the spline to a
-.R file or to a .txt for future plotting */
-int graphPoints;
+    /* Fraction of the range of a spline on the y-axis for determining which
+    segments of the spline count as asymptotes. If the oscillations of the
+    spline at one of its extremities are contained within a horizontal area
+    with size determined by this value, the corresponding segment is identified
+    as an asymptote */
+    double fractionOfOrdinateRangeForAsymptoteIdentification = 0.005;
 
-/**/
-string criterion;
+    /* Fraction of the range of a spline on the y-axis for determining which
+    points count as well-defined maxima. In order to be considered a
+    well-defined maximum, a point in a spline must not only be a local
+    maximum, it must also have sufficient prominence: on both sides, it must
+    be higher than the lowest point between it and the nearest higher maximum,
+    or the end of the spline, by at least this fraction of the range */
+    double fractionOfOrdinateRangeForMaximumIdentification = 0.025;
+
+    /* Specifies whether negative segments on the y-axis are admissible for the
+    splines or whether they should be replaced with straight lines with
+    ordinate 0 */
+    //bool possibleNegativeOrdinates;
+
+    /**/
+    //bool removeAsymptotes;
+
+    /* Pascal's triangle, up to row g */
+    vector<vector<double>> pascalsTriangle;
+
+    /* Number of points to be calculated for each spline when saving the
+    spline to a .R file or to a .txt for future plotting */
+    int graphPoints = 500;
+
+    /**/
+    string criterion = "AIC";
+
+    ////////////////////////////////////////////////////////////////////////////
+
+    /* Sets the degree of the basis functions, and the quantities depending on
+    it */
+    void setDegree(int degree);
+
+};
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+
+
+void Settings::setDegree(int degree) {
+
+    g = degree;
+    m = g + 1;
+
+    pascalsTriangle = vector<vector<double>>(m);
+    for (int a=0; a<m; ++a) {
+        pascalsTriangle[a] = vector<double>(a+1,1);
+        for (int b=1; b<a; ++b)
+            pascalsTriangle[a][b] =
+                pascalsTriangle[a-1][b-1] + pascalsTriangle[a-1][b];
+    }
+
+}
+
+
+
+int indexOfName(const char* name, const char* const* names, int numberOfNames) {
+
+    if (name == nullptr)
+        return -1;
+
+    for (int a=0; a<numberOfNames; ++a)
+        if (strcmp(name, names[a]) == 0)
+            return a;
+
+    return -1;
+
+}
 
 #endif //SPLINE_SETTINGS_H
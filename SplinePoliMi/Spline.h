@@ -1,19 +1,65 @@
 
 #include "Settings.h"
 
-class Spline {
-
-public:
+/* Data points of a spline, and the quantities obtained from them which do not
+depend on the knots. It is shared by the candidate splines calculated from the
+same data, which keep a pointer to it instead of a copy */
+struct SplineData {
 
     /* Type of spline. 0: Experimental data;  1: Model;  2: Error spline */
     int splineType;
 
-    /* Abscissae of the spline */
+    /* Abscissae, as initially obtained from the input file */
+    vector<double> originalAbscissae;
+
+    /* Ordinates, as initially obtained from the input file */
+    vector<double> originalOrdinates;
+
+    /* Abscissae used for calculating the spline. For models, points are added
+    where the original ones are too sparse */
     vector<double> abscissae;
 
-    /* Ordinates of the spline */
+    /* Ordinates used for calculating the spline */
     vector<double> ordinates;
 
+    /* Mean distance between consecutive abscissae */
+    double meanKnotDistance;
+
+    /* Distance between the biggest and the smallest ordinates */
+    double height;
+
+    /* Estimated first derivatives at the abscissae. Contains an additional 0
+    at position 0 */
+    vector<double> estimatedD1;
+
+    ////////////////////////////////////////////////////////////////////////////
+
+    /* Sets the data points and calculates the other quantities */
+    void prepare(const vector<double>& abscissae,
+                 const vector<double>& ordinates,
+                 int splineType);
+
+};
+
+
+
+/* Smallest number of polynomials for which a spline builds its bucket index.
+Below it the binary search is just as fast */
+const int minimumPolynomialsForBucketIndex = 64;
+
+
+
+class Spline {
+
+public:
+
+    /* Type of spline. 0: Experimental data;  1: Model;  2: Error spline */
+    int splineType;
+
+    /* Data points of the spline, shared with the other candidate splines
+    calculated from the same data */
+    shared_ptr<const SplineData> data;
+
     /* Number of data points */
     int n;
 
@@ -46,66 +92,128 @@ public:
     coeffD2[i][j] refers to polynomial i and the coefficient of x^j */
     vector<vector<double>> coeffD2;
 
-    /* Abscissae of the spline, as initially obtained from the input file */
-    vector<double> originalAbscissae;
-
-    /* Ordinates of the spline, as initially obtained from the input file */
-    vector<double> originalOrdinates;
-
     /* Distance between the biggest and the smallest abscissae of the spline */
     double xRange;
 
     /* Degrees of freedom of the spline */
     int K;
 
+    /* Degree of the polynomials of the spline */
+    int g;
+
+    /* Order of the polynomials of the spline */
+    int m;
+
+    /* Number of values of the smoothing parameter lambda for which GCV1 was
+    calculated */
+    int numberOfLambdaEvaluations;
+
+    /* Ordinates of the spline at the abscissae */
+    vector<double> fittedOrdinates;
+
+    /* Sum of squared errors between the ordinates and fittedOrdinates */
+    double SSE;
+
+    /* Trace of the smoother matrix S, equal to the effective degrees of freedom
+    of the spline */
+    double traceS;
+
     ////////////////////////////////////////////////////////////////////////////
 
-    /* Calculates the spline */
-    void solve(const vector<double>& abscissae,
-               const vector<double>& ordinates,
-               int splineType,
-               int numberOfAbscissaeSeparatingConsecutiveKnots);
+    /* Calculates the spline, using 'workspace' for the temporaries */
+    void solve(const shared_ptr<const SplineData>& data,
+               int numberOfAbscissaeSeparatingConsecutiveKnots,
+               const Settings& settings,
+               SplineWorkspace& workspace);
 
     /* Calculates the ordinate of the spline at position x on the x-axis */
-    double D0(double x);
+    double D0(double x) const;
 
     /* Calculates the ordinate of the first derivative of the spline at position
     x on the x-axis */
-    double D1(double x);
+    double D1(double x) const;
 
     /* Calculates the ordinate of the second derivative of the spline at
     position x on the x-axis */
-    double D2(double x);
+    double D2(double x) const;
+
+    /* As D0(x), D1(x) and D2(x), finding the polynomial containing x with
+    findPolynomial(x, hint) */
+    double D0(double x, int& hint) const;
+    double D1(double x, int& hint) const;
+    double D2(double x, int& hint) const;
+
+    /* Calculates the ordinates of the spline and of its first and second
+    derivatives at position x on the x-axis, finding the polynomial containing
+    x once. The results are the same as those of D0(x), D1(x) and D2(x) */
+    void D0D1D2(double x, double& d0, double& d1, double& d2) const;
+
+    /* As D0D1D2(x, d0, d1, d2), finding the polynomial containing x with
+    findPolynomial(x, hint) */
+    void D0D1D2(double x, int& hint, double& d0, double& d1, double& d2) const;
+
+    /* Returns the index of the polynomial containing position x on the
+    x-axis: the last polynomial whose left knot is smaller than x, or the first
+    polynomial. Uses the bucket index if it was built, otherwise a binary
+    search */
+    int findPolynomial(double x) const;
+
+    /* As findPolynomial(x), starting the search from polynomial 'hint', which
+    is then set to the result. When consecutive calls are sorted along the
+    x-axis, each one costs a constant time */
+    int findPolynomial(double x, int& hint) const;
+
+    /* Divides the range of the spline into numberOfBuckets buckets of equal
+    width, and saves for each of them the polynomial containing its left end,
+    so that findPolynomial(x) only checks the knots inside the bucket of x */
+    void buildBucketIndex(int numberOfBuckets);
+
+    /* Calculates the spline and its first and second derivatives at the n
+    equally spaced abscissae start + i*step, i = 0, ..., n-1, with
+    samplePiecewisePolynomial. d0, d1 and d2 can be null, if not needed */
+    void sample(double start, double step, int n,
+                double* d0, double* d1, double* d2) const;
 
     /* Calculates the ordinate of the spline at position powersOfX[1] on the
     x-axis, using the normalized spline coefficients */
-    double D0(const vector<double>& powersOfX);
+    double D0(const vector<double>& powersOfX) const;
 
     /* Calculates the ordinate of the first derivative of the spline at position
     powersOfX[1] on the x-axis, using the normalized spline coefficients */
-    double D1(const vector<double>& powersOfX);
+    double D1(const vector<double>& powersOfX) const;
 
     /* Calculates the ordinate of the spline at position powersOfX[1] on the
     x-axis, using the normalized and shifted spline coefficients */
-    double D0Shift(const vector<double>& powersOfX);
+    double D0Shift(const vector<double>& powersOfX) const;
 
     /* Calculates the ordinate of the first derivative of the spline at position
     powersOfX[1] on the x-axis, using the normalized and shifted spline
     coefficients */
-    double D1Shift(const vector<double>& powersOfX);
+    double D1Shift(const vector<double>& powersOfX) const;
 
     /* Calculates coeffD0_shift_normalized, coeffD1_shift_normalized and
     knots_shift */
-    void calculateShift(double shift);
+    void calculateShift(double shift, const Settings& settings);
 
     /* Calculates the real different roots of the spline or of the first or of
     the second derivative of the spline. Returns a vector with the roots sorted
     from smallest to largest. Returns a size() = 0 vector if there are no real
     roots */
-    vector<double> calculateRoots(double derivativeOrder);
-
-    /* Powers of the abscissa being considered */
-    vector<double> powers;
+    vector<double> calculateRoots(int derivativeOrder) const;
+
+    /* Calculates the local maxima and minima of the spline with findExtrema,
+    sorted along the x-axis */
+    vector<Extremum> calculateExtrema(
+        double fractionOfOrdinateRangeForMaximumIdentification) const;
+
+    /* Calculates with splineDistance the L2 distances between this spline and
+    'other', and between their first derivatives, on the intersection of their
+    domains. Returns false if they cannot be calculated */
+    bool calculateDistance(const Spline& other,
+                           DistanceNormalization normalization,
+                           bool divideByDomainLength,
+                           double& distanceD0,
+                           double& distanceD1) const;
 
 ////////////////////////////////////////////////////////////////////////////////
 
@@ -132,12 +240,6 @@ private:
     log10lambda */
     double log10lambdaMax;
 
-    /* Spline coefficients for obtaining coeffD0, coeffD1 and coeffD2 */
-    vector<double> splineCoefficients;
-
-    /* Knots of the spline, including non-real ones at the end points */
-    vector<double> knotsForCalculations;
-
     /* Number of polynomials which are asymptotes on the left of the spline */
     double numberOfAsymptotePolynomialsLeft;
 
@@ -164,15 +266,53 @@ private:
     /* Real knots of the spline, shifted */
     vector<double> knots_shift;
 
+    /* Kernels evaluating the polynomials of coeffD0, coeffD1 and coeffD2,
+    chosen according to g once the coefficients are calculated */
+    HornerKernel kernelD0 = &hornerAnyDegree;
+    HornerKernel kernelD1 = &hornerAnyDegree;
+    HornerKernel kernelD2 = &hornerAnyDegree;
+
+    /* For each bucket of the bucket index, the polynomial containing its left
+    end. Empty if the index was not built */
+    vector<int> bucketFirstPolynomial;
+
+    /* Width of the buckets of the bucket index */
+    double bucketWidth;
+
+    /* coeffD0, coeffD1 and coeffD2, one polynomial after the other, m
+    coefficients for each polynomial, as taken by the functions of
+    SplineEvaluation.h and SplineAnalysis.h. Saved once the coefficients are
+    calculated, so that those functions do not need a copy at each call */
+    vector<double> flatCoeffD0;
+    vector<double> flatCoeffD1;
+    vector<double> flatCoeffD2;
+
     ////////////////////////////////////////////////////////////////////////////
 
-    /* Chooses the knots for the spline */
-    void chooseKnots(int numberOfAbscissaeSeparatingConsecutiveKnots);
+    /* Returns the coefficients of the polynomials in 'coefficients', which is
+    one of coeffD0, coeffD1 and coeffD2, one polynomial after the other, m for
+    each polynomial */
+    vector<double> flatCoefficients(
+        const vector<vector<double>>& coefficients) const;
+
+    /* Returns the index of the last polynomial whose left knot, among the first
+    numberOfKnots-1 elements of knotsToSearch, is smaller than x, or 0 */
+    int searchPolynomial(const vector<double>& knotsToSearch, double x) const;
+
+    /* Chooses the knots for the spline, and saves them in workspace.knots
+    and workspace.knotsForCalculations */
+    void chooseKnots(int numberOfAbscissaeSeparatingConsecutiveKnots,
+                     SplineWorkspace& workspace);
 
-    /* Calculates the coefficients of the polynomials of the spline and the
-    coefficients of the first derivative of the polynomials of the spline, for
-    the real knots of the spline */
-    void calculateCoefficients();
+    /* Calculates the spline coefficients minimizing GCV1, and saves them in
+    workspace.minimum */
+    void calculateCoefficients(const Settings& settings,
+                               SplineWorkspace& workspace);
+
+    /* Calculates the coefficients of the polynomials of the spline and of
+    their first and second derivatives, for the real knots of the spline, from
+    the spline coefficients in workspace.minimum */
+    void calculatePolynomials(SplineWorkspace& workspace);
 
 };
 
@@ -184,118 +324,406 @@ private:
 
 
 
-void Spline::solve(const vector<double>& Abscissae,
-                   const vector<double>& Ordinates,
-                   int SplineType,
-                   int numberOfAbscissaeSeparatingConsecutiveKnots) {
+void SplineData::prepare(const vector<double>& Abscissae,
+                         const vector<double>& Ordinates,
+                         int SplineType) {
+
+    splineType = SplineType;
 
+    originalAbscissae = Abscissae;
+    originalOrdinates = Ordinates;
     abscissae = Abscissae;
     ordinates = Ordinates;
-    splineType = SplineType;
 
-    n = abscissae.size();
+    int n = abscissae.size();
+
+    if (n < 2)
+        return;
+
+    meanKnotDistance =
+        (abscissae.back()-abscissae[0]) / (double)(abscissae.size()-1);
+
+    if (splineType == 1 /*Model*/) {
+
+        vector<double> newX;
+        vector<double> newY;
+
+        newX.push_back(abscissae[0]);
+        newY.push_back(ordinates[0]);
+
+        // If there are less than 30 points, adds enough points to the spline to
+        // reach at least 30 points
+        if (abscissae.size() < 30) {
+
+            double abscissaeLength = (abscissae.back()-abscissae[0]);
+            int minPointsToAdd = 30-abscissae.size();
+
+            for (int a=1; a<(int)abscissae.size(); ++a) {
+                double segmentLength = (abscissae[a]-abscissae[a-1]);
+                int numberOfPointstoAdd =
+                    segmentLength/abscissaeLength*(double)(minPointsToAdd+1);
+                double distanceBetweenPoints =
+                    segmentLength/(double)(numberOfPointstoAdd+1);
+                double slope = (ordinates[a]-ordinates[a-1])/segmentLength;
+                for (int b=0; b<numberOfPointstoAdd; ++b) {
+                    newX.push_back(newX.back()+distanceBetweenPoints);
+                    newY.push_back(
+                        ordinates[a-1]+slope*(newX.back()-abscissae[a-1]));
+                }
+            newX.push_back(abscissae[a]);
+            newY.push_back(ordinates[a]);
+            }
+        }
+
+        // Adds extra points between consecutive data points with a distance on
+        // the x-axis greater than 3.*meanKnotDistance
+        if (abscissae.size() >= 30)
+            for (int a=1; a<(int)abscissae.size(); ++a) {
+                double segmentLength = (abscissae[a]-abscissae[a-1]);
+                if (segmentLength > 3.*meanKnotDistance) {
+                    int numberOfNewPoints =
+                        (int)(segmentLength/meanKnotDistance);
+                    double distanceBetweenPoints =
+                        segmentLength / (double)(numberOfNewPoints+1);
+                    double slope = (ordinates[a]-ordinates[a-1])/segmentLength;
+                    for (int b=0; b<numberOfNewPoints; ++b) {
+                        newX.push_back(newX.back()+distanceBetweenPoints);
+                        newY.push_back(
+                            ordinates[a-1]+slope*(newX.back()-abscissae[a-1]));
+                    }
+                }
+                newX.push_back(abscissae[a]);
+                newY.push_back(ordinates[a]);
+            }
+
+        abscissae = newX;
+        ordinates = newY;
+
+        n = abscissae.size();
+
+		meanKnotDistance =
+			(abscissae.back()-abscissae[0]) / (double)(abscissae.size()-1);
 
-    if (originalAbscissae.size() == 0) {
-        originalAbscissae = abscissae;
-        originalOrdinates = ordinates;
     }
 
-    possibleToCalculateSpline = abscissae.size() > 1 ? true : false;
+	double maxOrdinate = ordinates[0];
+	double minOrdinate = ordinates[0];
+	for (int a=1; a<n; ++a) {
+		if (ordinates[a] > maxOrdinate)
+			maxOrdinate = ordinates[a];
+		if (ordinates[a] < minOrdinate)
+			minOrdinate = ordinates[a];
+	}
+	height = maxOrdinate - minOrdinate;
+
+    // Estimates the first derivatives of the data. Contains an additional 0
+    // at position 0
+    estimatedD1 = vector<double>(n-1,0);
+    for (int i=1; i<n-1; ++i)
+        estimatedD1[i] =
+            (ordinates[i+1]-ordinates[i-1]) / (abscissae[i+1]-abscissae[i-1]);
+
+}
+
+
+
+void Spline::solve(const shared_ptr<const SplineData>& Data,
+                   int numberOfAbscissaeSeparatingConsecutiveKnots,
+                   const Settings& settings,
+                   SplineWorkspace& workspace) {
+
+    g = settings.g;
+    m = settings.m;
+
+    data = Data;
+    splineType = data->splineType;
+
+    n = data->abscissae.size();
+
+    possibleToCalculateSpline = n > 1 ? true : false;
 
     if (!possibleToCalculateSpline)
         return;
 
-    this->chooseKnots(numberOfAbscissaeSeparatingConsecutiveKnots);
+    // Only the temporaries are counted by the workspace: the knots and the
+    // polynomials of the spline are its results
+    workspace.beginFit();
 
-    this->calculateCoefficients();
+    this->chooseKnots(numberOfAbscissaeSeparatingConsecutiveKnots, workspace);
 
+    this->calculateCoefficients(settings, workspace);
 
-//    this->findMaximaBetweenExtremes();
+    workspace.endFit();
 
+    this->calculatePolynomials(workspace);
 
+}
+
+double Spline::D0(double x) const {
+
+    int indexOfPolynomial = findPolynomial(x);
+
+    // Calculates D0(x)
+    return kernelD0(coeffD0[indexOfPolynomial].data(), g, x);
 
 }
 
-double Spline::D0(double x) {
 
-    int indexOfPolynomial = 0;
-    for (int i=0; i<numberOfKnots-1; ++i)
-        if (x > knots[i])
-            indexOfPolynomial = i;
-        else
-            break;
 
-    // Calculates the powers of x
-    for (int i=1; i<m; ++i)
-        powers[i] = powers[i-1]*x;
+double Spline::D1(double x) const {
 
-    // Calculates D0(x)
-    double y = 0;
-    for (int i=0; i<m; ++i)
-        y += coeffD0[indexOfPolynomial][i]*powers[i];
+    int indexOfPolynomial = findPolynomial(x);
 
-    return y;
+    // Calculates D1(x)
+    return kernelD1(coeffD1[indexOfPolynomial].data(), g-1, x);
 
 }
 
 
 
-double Spline::D1(double x) {
+double Spline::D2(double x) const {
 
-    int indexOfPolynomial = 0;
-    for (int i=0; i<numberOfKnots-1; ++i)
-        if (x > knots[i])
-            indexOfPolynomial = i;
-        else
-            break;
+    int indexOfPolynomial = findPolynomial(x);
 
-    // Calculates the powers of x
-    for (int i=1; i<g; ++i)
-        powers[i] = powers[i-1]*x;
+    // Calculates D2(x)
+    return kernelD2(coeffD2[indexOfPolynomial].data(), g-2, x);
 
-    // Calculates D1(x)
-    double y = 0;
-    for (int i=0; i<g; ++i)
-        y += coeffD1[indexOfPolynomial][i]*powers[i];
+}
 
-    return y;
+
+
+double Spline::D0(double x, int& hint) const {
+
+    int indexOfPolynomial = findPolynomial(x, hint);
+
+    return kernelD0(coeffD0[indexOfPolynomial].data(), g, x);
 
 }
 
 
 
-double Spline::D2(double x) {
+double Spline::D1(double x, int& hint) const {
 
-    int indexOfPolynomial = 0;
-    for (int i=0; i<numberOfKnots-1; ++i)
-        if (x > knots[i])
-            indexOfPolynomial = i;
-        else
-            break;
+    int indexOfPolynomial = findPolynomial(x, hint);
 
-    // Calculates the powers of x
-    for (int i=1; i<g-1; ++i)
-        powers[i] = powers[i-1]*x;
+    return kernelD1(coeffD1[indexOfPolynomial].data(), g-1, x);
 
-    // Calculates D2(x)
-    double y = 0;
-    for (int i=0; i<g-1; ++i)
-        y += coeffD2[indexOfPolynomial][i]*powers[i];
+}
 
-    return y;
+
+
+double Spline::D2(double x, int& hint) const {
+
+    int indexOfPolynomial = findPolynomial(x, hint);
+
+    return kernelD2(coeffD2[indexOfPolynomial].data(), g-2, x);
+
+}
+
+
+
+void Spline::D0D1D2(double x, double& d0, double& d1, double& d2) const {
+
+    int indexOfPolynomial = findPolynomial(x);
+
+    d0 = kernelD0(coeffD0[indexOfPolynomial].data(), g, x);
+    d1 = kernelD1(coeffD1[indexOfPolynomial].data(), g-1, x);
+    d2 = kernelD2(coeffD2[indexOfPolynomial].data(), g-2, x);
 
 }
 
 
 
-double Spline::D0(const vector<double>& powersOfX) {
+void Spline::D0D1D2(double x, int& hint,
+                    double& d0, double& d1, double& d2) const {
+
+    int indexOfPolynomial = findPolynomial(x, hint);
 
-    int indexOfPolynomial = 0;
-    for (int i=0; i<numberOfKnots-1; ++i)
-        if (powersOfX[1] > knots[i])
-            indexOfPolynomial = i;
-        else
-            break;
+    d0 = kernelD0(coeffD0[indexOfPolynomial].data(), g, x);
+    d1 = kernelD1(coeffD1[indexOfPolynomial].data(), g-1, x);
+    d2 = kernelD2(coeffD2[indexOfPolynomial].data(), g-2, x);
+
+}
+
+
+
+int Spline::findPolynomial(double x) const {
+
+    if (bucketFirstPolynomial.empty())
+        return searchPolynomial(knots, x);
+
+    // Abscissae on the left of the spline, and NaN, belong to the first
+    // polynomial
+    if (!(x > knots[0]))
+        return 0;
+
+    int numberOfBuckets = bucketFirstPolynomial.size();
+    double bucket = (x-knots[0])/bucketWidth;
+    int indexOfBucket = bucket < (double)numberOfBuckets ?
+                        (int)bucket : numberOfBuckets-1;
+
+    // Moves from the polynomial containing the left end of the bucket to the
+    // one containing x. Moving left is only needed if rounding put x in the
+    // following bucket
+    int indexOfPolynomial = bucketFirstPolynomial[indexOfBucket];
+    while (indexOfPolynomial < numberOfKnots-2 &&
+           x > knots[indexOfPolynomial+1])
+        ++indexOfPolynomial;
+    while (indexOfPolynomial > 0 && !(x > knots[indexOfPolynomial]))
+        --indexOfPolynomial;
+
+    return indexOfPolynomial;
+
+}
+
+
+
+int Spline::findPolynomial(double x, int& hint) const {
+
+    int indexOfPolynomial = max(0, min(hint, numberOfKnots-2));
+
+    // Checks the polynomials next to the hint, and falls back on the search
+    // over all the polynomials if x is farther away
+    for (int step=0; step<4; ++step) {
+        if (indexOfPolynomial < numberOfKnots-2 &&
+            x > knots[indexOfPolynomial+1])
+            ++indexOfPolynomial;
+        else if (indexOfPolynomial > 0 && !(x > knots[indexOfPolynomial]))
+            --indexOfPolynomial;
+        else {
+            hint = indexOfPolynomial;
+            return indexOfPolynomial;
+        }
+    }
+
+    hint = findPolynomial(x);
+    return hint;
+
+}
+
+
+
+void Spline::buildBucketIndex(int numberOfBuckets) {
+
+    bucketFirstPolynomial.assign(max(numberOfBuckets,1),0);
+    bucketWidth = (knots.back()-knots[0])/(double)bucketFirstPolynomial.size();
+
+    for (int b=0; b<(int)bucketFirstPolynomial.size(); ++b)
+        bucketFirstPolynomial[b] =
+            searchPolynomial(knots, knots[0]+(double)b*bucketWidth);
+
+}
+
+
+
+void Spline::sample(double start, double step, int n,
+                    double* d0, double* d1, double* d2) const {
+
+    samplePiecewisePolynomial(knots.data(), numberOfKnots, flatCoeffD0.data(),
+                              m, g, start, step, n, d0, d1, d2);
+
+}
+
+
+
+vector<double> Spline::calculateRoots(int derivativeOrder) const {
+
+    const vector<double>& coefficients =
+        derivativeOrder == 0 ? flatCoeffD0 :
+        derivativeOrder == 1 ? flatCoeffD1 : flatCoeffD2;
+
+    vector<double> roots;
+    realRootsOfPiecewisePolynomial(knots.data(),
+                                   numberOfKnots,
+                                   coefficients.data(),
+                                   m,
+                                   g-derivativeOrder,
+                                   roots);
+
+    return roots;
+
+}
+
+
+
+vector<Extremum> Spline::calculateExtrema(
+    double fractionOfOrdinateRangeForMaximumIdentification) const {
+
+    vector<Extremum> extrema;
+    findExtrema(knots.data(),
+                numberOfKnots,
+                flatCoeffD0.data(),
+                flatCoeffD1.data(),
+                flatCoeffD2.data(),
+                m,
+                g,
+                fractionOfOrdinateRangeForMaximumIdentification,
+                extrema);
+
+    return extrema;
+
+}
+
+
+
+bool Spline::calculateDistance(const Spline& other,
+                               DistanceNormalization normalization,
+                               bool divideByDomainLength,
+                               double& distanceD0,
+                               double& distanceD1) const {
+
+    return splineDistance(knots.data(),
+                          numberOfKnots,
+                          flatCoeffD0.data(),
+                          flatCoeffD1.data(),
+                          m,
+                          g,
+                          other.knots.data(),
+                          other.numberOfKnots,
+                          other.flatCoeffD0.data(),
+                          other.flatCoeffD1.data(),
+                          other.m,
+                          other.g,
+                          normalization,
+                          divideByDomainLength,
+                          distanceD0,
+                          distanceD1);
+
+}
+
+
+
+vector<double> Spline::flatCoefficients(
+    const vector<vector<double>>& coefficients) const {
+
+    vector<double> flat(numberOfPolynomials*m);
+    for (int j=0; j<numberOfPolynomials; ++j)
+        copy(coefficients[j].begin(), coefficients[j].begin()+m,
+             flat.begin()+j*m);
+
+    return flat;
+
+}
+
+
+
+int Spline::searchPolynomial(const vector<double>& knotsToSearch,
+                             double x) const {
+
+    int indexOfPolynomial =
+        lower_bound(knotsToSearch.begin(),
+                    knotsToSearch.begin()+numberOfKnots-1,
+                    x) - knotsToSearch.begin() - 1;
+
+    return max(indexOfPolynomial,0);
+
+}
+
+
+
+double Spline::D0(const vector<double>& powersOfX) const {
+
+    int indexOfPolynomial = findPolynomial(powersOfX[1]);
 
     // Calculates D0(powersOfX[1])
     double y = 0;
@@ -308,14 +736,9 @@ double Spline::D0(const vector<double>& powersOfX) {
 
 
 
-double Spline::D1(const vector<double>& powersOfX) {
+double Spline::D1(const vector<double>& powersOfX) const {
 
-    int indexOfPolynomial = 0;
-    for (int i=0; i<numberOfKnots-1; ++i)
-        if (powersOfX[1] > knots[i])
-            indexOfPolynomial = i;
-        else
-            break;
+    int indexOfPolynomial = findPolynomial(powersOfX[1]);
 
     // Calculates D1(powersOfX[1])
     double y = 0;
@@ -328,14 +751,9 @@ double Spline::D1(const vector<double>& powersOfX) {
 
 
 
-double Spline::D0Shift(const vector<double>& powersOfX) {
+double Spline::D0Shift(const vector<double>& powersOfX) const {
 
-    int indexOfPolynomial = 0;
-    for (int i=0; i<numberOfKnots-1; ++i)
-        if (powersOfX[1] > knots_shift[i])
-            indexOfPolynomial = i;
-        else
-            break;
+    int indexOfPolynomial = searchPolynomial(knots_shift, powersOfX[1]);
 
     // Calculates D0(powersOfX[1])
     double y = 0;
@@ -348,14 +766,9 @@ double Spline::D0Shift(const vector<double>& powersOfX) {
 
 
 
-double Spline::D1Shift(const vector<double>& powersOfX) {
+double Spline::D1Shift(const vector<double>& powersOfX) const {
 
-    int indexOfPolynomial = 0;
-    for (int i=0; i<numberOfKnots-1; ++i)
-        if (powersOfX[1] > knots_shift[i])
-            indexOfPolynomial = i;
-        else
-            break;
+    int indexOfPolynomial = searchPolynomial(knots_shift, powersOfX[1]);
 
     // Calculates D1(powersOfX[1])
     double y = 0;
@@ -368,7 +781,9 @@ double Spline::D1Shift(const vector<double>& powersOfX) {
 
 
 
-void Spline::calculateShift(double Shift) {
+void Spline::calculateShift(double Shift, const Settings& settings) {
+
+    const vector<vector<double>>& pascalsTriangle = settings.pascalsTriangle;
 
     shift = Shift;
 
@@ -426,87 +841,22 @@ void Spline::calculateShift(double Shift) {
 
 
 
-void Spline::chooseKnots(int numberOfAbscissaeSeparatingConsecutiveKnots) {
+void Spline::chooseKnots(int numberOfAbscissaeSeparatingConsecutiveKnots,
+                         SplineWorkspace& workspace) {
 
     int number = numberOfAbscissaeSeparatingConsecutiveKnots;
 
-    double meanKnotDistance =
-        (abscissae.back()-abscissae[0]) / (double)(abscissae.size()-1);
+    const vector<double>& abscissae = data->abscissae;
+    const vector<double>& ordinates = data->ordinates;
+    double meanKnotDistance = data->meanKnotDistance;
+    double height = data->height;
 
-    if (splineType == 1 /*Model*/) {
+    // The knots are chosen in the workspace, which keeps its memory, and
+    // copied to the spline at the end of the fit
+    vector<double>& newKnots = workspace.knots;
+    newKnots.clear();
 
-        vector<double> newX;
-        vector<double> newY;
-
-        newX.push_back(abscissae[0]);
-        newY.push_back(ordinates[0]);
-
-        // If there are less than 30 points, adds enough points to the spline to
-        // reach at least 30 points
-        if (abscissae.size() < 30) {
-
-            double abscissaeLength = (abscissae.back()-abscissae[0]);
-            int minPointsToAdd = 30-abscissae.size();
-
-            for (int a=1; a<(int)abscissae.size(); ++a) {
-                double segmentLength = (abscissae[a]-abscissae[a-1]);
-                int numberOfPointstoAdd =
-                    segmentLength/abscissaeLength*(double)(minPointsToAdd+1);
-                double distanceBetweenPoints =
-                    segmentLength/(double)(numberOfPointstoAdd+1);
-                double slope = (ordinates[a]-ordinates[a-1])/segmentLength;
-                for (int b=0; b<numberOfPointstoAdd; ++b) {
-                    newX.push_back(newX.back()+distanceBetweenPoints);
-                    newY.push_back(
-                        ordinates[a-1]+slope*(newX.back()-abscissae[a-1]));
-                }
-            newX.push_back(abscissae[a]);
-            newY.push_back(ordinates[a]);
-            }
-        }
-
-        // Adds extra points between consecutive data points with a distance on
-        // the x-axis greater than 3.*meanKnotDistance
-        if (abscissae.size() >= 30)
-            for (int a=1; a<(int)abscissae.size(); ++a) {
-                double segmentLength = (abscissae[a]-abscissae[a-1]);
-                if (segmentLength > 3.*meanKnotDistance) {
-                    int numberOfNewPoints =
-                        (int)(segmentLength/meanKnotDistance);
-                    double distanceBetweenPoints =
-                        segmentLength / (double)(numberOfNewPoints+1);
-                    double slope = (ordinates[a]-ordinates[a-1])/segmentLength;
-                    for (int b=0; b<numberOfNewPoints; ++b) {
-                        newX.push_back(newX.back()+distanceBetweenPoints);
-                        newY.push_back(
-                            ordinates[a-1]+slope*(newX.back()-abscissae[a-1]));
-                    }
-                }
-                newX.push_back(abscissae[a]);
-                newY.push_back(ordinates[a]);
-            }
-
-        abscissae = newX;
-        ordinates = newY;
-
-        n = abscissae.size();
-
-		meanKnotDistance =
-			(abscissae.back()-abscissae[0]) / (double)(abscissae.size()-1);
-
-    }
-
-	double maxOrdinate = ordinates[0];
-	double minOrdinate = ordinates[0];
-	for (int a=1; a<n; ++a) {
-		if (ordinates[a] > maxOrdinate)
-			maxOrdinate = ordinates[a];
-		if (ordinates[a] < minOrdinate)
-			minOrdinate = ordinates[a];
-	}
-	double height = maxOrdinate - minOrdinate;
-
-    knots.push_back(abscissae[0]);
+    newKnots.push_back(abscissae[0]);
 
     if (abscissae.size() > 2) {
 
@@ -522,7 +872,7 @@ void Spline::chooseKnots(int numberOfAbscissaeSeparatingConsecutiveKnots) {
                 l > 0)
                 if (difference > 0.2*meanKnotDistance)
                     if (ordinates[a] != y) {
-                        knots.push_back(abscissae[a]);
+                        newKnots.push_back(abscissae[a]);
                         y = ordinates[a];
                         k = 0;
                         --l;
@@ -535,24 +885,24 @@ void Spline::chooseKnots(int numberOfAbscissaeSeparatingConsecutiveKnots) {
         // horizontal asymptote. Some of the intervals chosen with this approach
         // might not contain any data points
         if (y == ordinates.back() && k > 10) { 
-            double knot = knots.back();
-            knots.push_back(knot+(abscissae.back()-knot)*4./12.);
-            knots.push_back(knot+(abscissae.back()-knot)*8./12.);
-            knots.push_back(knot+(abscissae.back()-knot)*10./12.);
-            knots.push_back(knot+(abscissae.back()-knot)*11./12.);
+            double knot = newKnots.back();
+            newKnots.push_back(knot+(abscissae.back()-knot)*4./12.);
+            newKnots.push_back(knot+(abscissae.back()-knot)*8./12.);
+            newKnots.push_back(knot+(abscissae.back()-knot)*10./12.);
+            newKnots.push_back(knot+(abscissae.back()-knot)*11./12.);
         }
 
     }
 
-    knots.push_back(abscissae.back());
+    newKnots.push_back(abscissae.back());
 
     // Sets the values of numberOfKnots, numberOfPolynomials, K and G
-    numberOfKnots = knots.size();
+    numberOfKnots = newKnots.size();
     numberOfPolynomials = numberOfKnots - 1;
     K = numberOfKnots - 2 + m;
     G = K-1;
 
-    xRange = knots.back() - knots[0];
+    xRange = newKnots.back() - newKnots[0];
 
     // Fills knotsForCalculations with the current knots plus additional knots
     // on the left and on the right of the spline, each at a distance from the
@@ -560,116 +910,65 @@ void Spline::chooseKnots(int numberOfAbscissaeSeparatingConsecutiveKnots) {
 
     double meanDistance = xRange / (double)numberOfPolynomials;
 
-    knotsForCalculations = vector<double>(numberOfKnots+2*g,0);
+    vector<double>& knotsForCalculations = workspace.knotsForCalculations;
+    knotsForCalculations.assign(numberOfKnots+2*g,0);
     for (int i=0; i<g; ++i)
-        knotsForCalculations[i] = knots[0] + (double)(i-g)*meanDistance;
+        knotsForCalculations[i] = newKnots[0] + (double)(i-g)*meanDistance;
     for (int i=0; i<numberOfKnots; ++i)
-        knotsForCalculations[i+g] = knots[i];
+        knotsForCalculations[i+g] = newKnots[i];
     for (int i=1; i<m; ++i)
         knotsForCalculations[i+g+numberOfPolynomials] =
-            knots.back()+(double)i*meanDistance;
+            newKnots.back()+(double)i*meanDistance;
 
 }
 
 
 
-void Spline::calculateCoefficients() {
+void Spline::calculateCoefficients(const Settings& settings,
+                                   SplineWorkspace& workspace) {
 
-    // Calculates the basis functions
-    auto basisFunctions = vector<BasisFunction>(K);
-    for (int j=0; j<K; ++j)
-        basisFunctions[j].calculateCoefficients(j,knotsForCalculations);
+    const vector<double>& abscissae = data->abscissae;
+    const vector<double>& ordinates = data->ordinates;
+    const vector<double>& knotsForCalculations = workspace.knotsForCalculations;
 
-    // Calculates the Fi matrix
-    auto Fi = vector<vector<double>>(n,vector<double>(K,0));
-    for (int i=0; i<n; ++i)
-        for (int j=0; j<K; ++j)
-            Fi[i][j] = basisFunctions[j].D0(abscissae[i]);
+    // Calculates the basis functions, all together in a single table
+    BasisFunctions& basisFunctions = workspace.basisFunctions;
+    basisFunctions.calculateCoefficients(knotsForCalculations,g);
 
-    // Finds the limits for the non-zero elements in Fi
-    auto firstInFi = vector<int>(n,0);
-    auto lastInFi = vector<int>(n,0);
-    for (int i=0; i<n; ++i)
-        for (int j=0; j<K; ++j)
-            if (Fi[i][j] != 0) {
-                firstInFi[i] = j;
-                break;
-            }
-    for (int i=0; i<n; ++i)
-        for (int j=G; j>-1; --j)
-            if (Fi[i][j] != 0) {
-                lastInFi[i] = j;
-                break;
-            }
+    // Calculates the Fi matrix. Each row contains the values of the m basis
+    // functions which can be non-zero at the corresponding abscissa
+    DesignMatrix& Fi = workspace.Fi;
+    Fi.build(abscissae, knotsForCalculations, basisFunctions, K, 0);
 
-    // Finds the limits for the non-zero elements in FiT
-    auto firstInFiT = vector<int>(K,0);
-    auto lastInFiT = vector<int>(K,0);
-    for (int j=0; j<K; ++j)
-        for (int i=0; i<n; ++i)
-            if (Fi[i][j] != 0) {
-                firstInFiT[j] = i;
-                break;
-            }
-    for (int j=0; j<K; ++j)
-        for (int i=n-1; i>-1; --i)
-            if (Fi[i][j] != 0) {
-                lastInFiT[j] = i;
-                break;
-            }
+    // Calculates the FiD1 matrix, containing the first derivatives of the basis
+    // functions at the abscissae. It does not depend on lambda, so it is
+    // calculated only once
+    DesignMatrix& FiD1 = workspace.FiD1;
+    FiD1.build(abscissae, knotsForCalculations, basisFunctions, K, 1);
 
-    // Finds the limits for the non-zero elements in M, R and FiTFi
-    auto firstInBandMatrices = vector<int>(K,0);
-    auto lastInBandMatrices = vector<int>(K,G);
-    if (K > m)
-        for (int i=m; i<K; ++i)
-            firstInBandMatrices[i] = i-g;
-    if (K > m)
-        for (int i=0; i<K-m; ++i)
-            lastInBandMatrices[i] = i+g;
-
-    // Calculates the FiTFi matrix, equal to the product of FiT and Fi
-    auto FiTFi = vector<vector<double>>(K,vector<double>(K,0));
-    for (int i=0; i<K; ++i)
-        for (int j=firstInBandMatrices[i]; j<=lastInBandMatrices[i]; ++j)
-            for (int k=0; k<n; ++k)
-                FiTFi[i][j] += Fi[k][i] * Fi[k][j];
-
-    // Calculates the R matrix
-    auto R = vector<vector<double>>(K,vector<double>(K,0));
-    for (int i=0; i<K; ++i)
-        for (int j=i; j<=lastInBandMatrices[i]; ++j)
-            R[i][j] = basisFunctions[i].integralOfProductD2(basisFunctions[j]);
-    for (int i=1; i<K; ++i)
-        for (int j=firstInBandMatrices[i]; j<i; ++j)
-            R[i][j] = R[j][i];
+    // Calculates the R matrix, either from the integrals of the products of the
+    // second derivatives of the basis functions or, for P-splines, from the
+    // differences between the coefficients of consecutive basis functions
+    BandMatrix& R = workspace.R;
+    if (settings.penalty == penaltyDifference)
+        basisFunctions.calculateDifferencePenalty(settings.differenceOrder, R);
+    else
+        basisFunctions.calculatePenalty(R);
+
+    // Calculates the FiTFi matrix, equal to the product of FiT and Fi. Only the
+    // band below the main diagonal is stored, as wide as the band of R
+    BandMatrix& FiTFi = workspace.FiTFi;
+    Fi.transposeTimesItself(FiTFi, R.bandwidth);
 
     // Calculates the FiTy vector
-    auto FiTy = vector<double>(K,0);
-    for (int i=0; i<K; ++i)
-        for (int k=firstInFiT[i]; k<=lastInFiT[i]; ++k)
-            FiTy[i] += Fi[k][i] * ordinates[k];
-
-    // Estimates the first derivatives of the experimental data. Contains an
-    // additional 0 at position 0
-    auto estimatedD1 = vector<double>(n-1,0);
-    for (int i=1; i<n-1; ++i)
-        estimatedD1[i] =
-            (ordinates[i+1]-ordinates[i-1]) / (abscissae[i+1]-abscissae[i-1]);
+    vector<double>& FiTy = workspace.FiTy;
+    Fi.transposeTimes(ordinates, FiTy);
 
     // Calculates the square root of the sum of squares of the elements of FiTFi
-    double indexFiTFi = 0;
-    for (int i=0; i<K; ++i)
-        for (int j=firstInBandMatrices[i]; j<=lastInBandMatrices[i]; ++j)
-            indexFiTFi += FiTFi[i][j] * FiTFi[i][j];
-    indexFiTFi = sqrt(indexFiTFi);
+    double indexFiTFi = FiTFi.norm();
 
     // Calculates the square root of the sum of squares of the elements of R
-    double indexR = 0;
-    for (int i=0; i<K; ++i)
-        for (int j=firstInBandMatrices[i]; j<=lastInBandMatrices[i]; ++j)
-            indexR += R[i][j] * R[i][j];
-    indexR = sqrt(indexR);
+    double indexR = R.norm();
 
     // Calculates the value of log10lambda for which the elements of FiTFi and R
     // have the same order of magnitude, rounded to the nearest 0.5
@@ -677,143 +976,84 @@ void Spline::calculateCoefficients() {
         round(2.*(log10(indexFiTFi)-log10(indexR)))/2.;
 
     // Calculates the end points of the log10lambda minimization interval
-    log10lambdaMin = log10lambdaForSameOrderOfMagnitude-(double)lambdaSearchInterval/2.;
-    log10lambdaMax = log10lambdaForSameOrderOfMagnitude+(double)lambdaSearchInterval/2.;
+    double lambdaSearchInterval = (double)settings.lambdaSearchInterval;
+    log10lambdaMin = log10lambdaForSameOrderOfMagnitude-lambdaSearchInterval/2.;
+    log10lambdaMax = log10lambdaForSameOrderOfMagnitude+lambdaSearchInterval/2.;
 
     // Calculates the log10 of the distance between two consecutive steps in the
-    // for cycle for minimizing log10lambda
-    double log10lambdaStep =
-        (double)lambdaSearchInterval/(double)(numberOfStepsLambda-1);
-
-    // Initializes the elements necessary for the minimization
-    auto M = vector<vector<double>>(K,vector<double>(K,0));
-    auto zed = vector<double>(K,0);
-    auto Z = vector<vector<double>>(K,vector<double>(K,0));
-    auto Minv = vector<vector<double>>(K,vector<double>(K,0));
-    auto MinvFiT = vector<vector<double>>(K,vector<double>(n,0));
-    auto splineCoefficientsForVariousLambdas =
-        vector<vector<double>>(numberOfStepsLambda,vector<double>(K,0));
-    auto GCV1 = vector<double>(numberOfStepsLambda,0);
-
-    // Calculates the spline coefficients and GCV1 for each lambda in the for
-    // cycle
-    for (int a=0; a<numberOfStepsLambda; ++a) {
-
-        // Obtains the value of lambda from that of a
-        lambda = pow(10., log10lambdaMin + (double)a * log10lambdaStep);
-
-        // Calculates the M matrix, sum of FiTFi and the product of Lambda and R
-        for (int i=0; i<K; ++i)
-            for (int j=firstInBandMatrices[i];j<=lastInBandMatrices[i];++j)
-                M[i][j] = FiTFi[i][j] + lambda * R[i][j];
-
-        // Uses the Doolittle decomposition to decompose M, and obtains the
-        // triangular matrices L and U (M = L*U). Saves the values of the L and
-        // U matrices, except for the main diagonal of L (consisting entirely of
-        // ones), in place of the respective values in matrix M
-        for (int i=0; i<K; ++i) {
-            for (int j=i; j<=lastInBandMatrices[i]; ++j)
-                for (int k=0; k<i; ++k)
-                    M[i][j] -= M[i][k] * M[k][j];
-            for (int j=i+1; j<=lastInBandMatrices[i]; ++j) {
-                for (int k=0; k<i; ++k)
-                    M[j][i] -= M[j][k] * M[k][i];
-                M[j][i] /= M[i][i];
-            }
-        }
-
-        // Calculates the zed vector, from the expression L*zed = FiTy, using
-        // the forward substitution technique
-        zed[0] = FiTy[0];
-        for (int i=1; i<K; ++i) {
-            zed[i] = FiTy[i];
-            for (int k=firstInBandMatrices[i]; k<i; ++k)
-                zed[i] -= M[i][k] * zed[k];
-        }
-
-        // Calculates the spline coefficients from R*coefficients = zed
-        splineCoefficientsForVariousLambdas[a][G] = zed[G] / M[G][G];
-        for (int i=G-1; i>-1; --i) {
-            splineCoefficientsForVariousLambdas[a][i] = zed[i];
-            for (int k=lastInBandMatrices[i]; k>i; --k)
-                splineCoefficientsForVariousLambdas[a][i] -=
-                M[i][k] * splineCoefficientsForVariousLambdas[a][k];
-            splineCoefficientsForVariousLambdas[a][i] /= M[i][i];
-        }
-
-        // Solves L*Z = I
-        for (int j=0; j<K; ++j) {
-            Z[j][j] = 1.;
-            for (int i=j+1; i<K; ++i) {
-                Z[i][j] = 0;
-                for (int k=firstInBandMatrices[i]; k<i; ++k)
-                    Z[i][j] -= M[i][k] * Z[k][j];
-            }
-        }
+    // for cycle for minimizing log10lambda. Brent's method only needs the grid
+    // to bracket the minimum, so a coarser one is used
+    int numberOfSteps = settings.lambdaOptimizer == lambdaOptimizerBrent ?
+                        settings.numberOfStepsLambdaBracket :
+                        settings.numberOfStepsLambda;
+    double log10lambdaStep = lambdaSearchInterval/(double)(numberOfSteps-1);
+
+    // Collects the elements necessary for the calculation of GCV1(lambda),
+    // which do not depend on lambda
+    GCV1Function GCV1;
+    GCV1.FiTFi = &FiTFi;
+    GCV1.R = &R;
+    GCV1.FiTy = &FiTy;
+    GCV1.FiD1 = &FiD1;
+    GCV1.estimatedD1 = &data->estimatedD1;
+    GCV1.n = n;
+
+    // If required, diagonalizes FiTFi and R once for all the values of lambda.
+    // If it is not possible, the band matrix M is factorized for each lambda
+    DemmlerReinsch& demmlerReinsch = workspace.demmlerReinsch;
+    if (settings.solver == solverDemmlerReinsch)
+        if (demmlerReinsch.calculate(FiTFi, R, FiTy,
+                                     pow(10.,log10lambdaForSameOrderOfMagnitude)))
+            GCV1.demmlerReinsch = &demmlerReinsch;
+
+    // Calculates the spline coefficients and GCV1 for each lambda in the
+    // grid, and finds the minimum value of GCV1(lambda). If required, the
+    // minimum is then refined with Brent's method
+    GCV1Minimum& minimum = workspace.minimum;
+    minimizeGCV1OnGrid(GCV1,
+                       log10lambdaMin,
+                       log10lambdaStep,
+                       numberOfSteps,
+                       settings.numberOfThreadsLambda,
+                       workspace.GCV1,
+                       minimum);
+    if (settings.lambdaOptimizer == lambdaOptimizerBrent)
+        refineGCV1WithBrent(GCV1,
+                            log10lambdaMin,
+                            log10lambdaMax,
+                            log10lambdaStep,
+                            settings.lambdaTolerance,
+                            settings.maximumLambdaEvaluations,
+                            workspace.GCV1,
+                            minimum);
+
+    // Saves the lambda and log10(lambda) corresponding to the minimum to
+    // 'lambda' and 'log10lambda'
+    log10lambda = minimum.log10lambda;
+    lambda = pow(10.,log10lambda);
+    numberOfLambdaEvaluations = minimum.numberOfEvaluations;
+    traceS = minimum.traceS;
 
-        // Solves R*Minv = Z
-        for (int j=G; j>-1; --j) {
-            Minv[G][j] = Z[G][j] / M[G][G];
-            for (int i=G-1; i>-1; --i) {
-                if (j < i)
-                    Minv[i][j] = Z[i][j];
-                else if (j > i)
-                    Minv[i][j] = 0;
-                else
-                    Minv[i][j] = 1.;
-                for (int k=lastInBandMatrices[i]; k>i; --k)
-                    Minv[i][j] -= M[i][k] * Minv[k][j];
-                Minv[i][j] /= M[i][i];
-            }
-        }
+}
 
-        // Calculates the MinvFiT matrix, equal to the product of Minv and FiT,
-        // in the locations necessary for the calculation of the trace of S
-        for (int j=0; j<n; ++j)
-            for (int i=firstInFi[j]; i<=lastInFi[j]; ++i) {
-                MinvFiT[i][j] = 0;
-                for (int k=firstInFi[j]; k<=lastInFi[j]; ++k)
-                    MinvFiT[i][j] += Minv[i][k] * Fi[j][k];
-            }
 
-        // Calculates the numerator of GCV1(Lambda)
-        double SSE1 = 0; // Sum of squared errors between yi' and f'(xi)
-        for (int i=1; i<n-1; ++i) {
-            double difference = estimatedD1[i];
-            for (int j=0; j<K; ++j)
-                difference -=
-                splineCoefficientsForVariousLambdas[a][j] *
-                basisFunctions[j].D1(abscissae[i]);
-            SSE1 += difference * difference;
-        }
-        GCV1[a] = (double)n * SSE1;
 
-        // Calculates the trace of matrix S
-        double traceS = 0;
-        for (int i=0; i<n; ++i)
-            for (int k=firstInFi[i]; k<=lastInFi[i]; ++k)
-                traceS += Fi[i][k] * MinvFiT[k][i];
+void Spline::calculatePolynomials(SplineWorkspace& workspace) {
 
-        // Calculates GCV1(Lambda)
-        GCV1[a] /= ((double)n-traceS)*((double)n-traceS);
+    const vector<double>& ordinates = data->ordinates;
+    const BasisFunctions& basisFunctions = workspace.basisFunctions;
+    const vector<double>& splineCoefficients = workspace.minimum.coefficients;
 
-    } // End of the for cycle for each lambda
+    knots = workspace.knots;
 
-    // Finds the minimum value of GCV1(lambda) in the GCV1 vector, and saves the
-    // corresponding spline coefficients to splineCoefficients and the
-    // corresponding lambda and log10(lambda) to 'lambda' and 'log10lambda'
-    double GCVOne = GCV1[0];
-    int index = 0;
-    log10lambda = log10lambdaMin;
-    lambda = pow(10.,log10lambda);
-    for (int i=1; i<numberOfStepsLambda; ++i)
-        if (GCV1[i] < GCVOne) {
-            GCVOne = GCV1[i];
-            index = i;
-            log10lambda = log10lambdaMin + (double)i * log10lambdaStep;
-            lambda = pow(10.,log10lambda);
-        }
-    splineCoefficients = splineCoefficientsForVariousLambdas[index];
+    // Calculates the ordinates of the spline at the abscissae and their sum of
+    // squared errors, used for choosing among the candidate splines
+    workspace.Fi.times(splineCoefficients, fittedOrdinates);
+    SSE = 0;
+    for (int i=0; i<n; ++i) {
+        double residual = ordinates[i] - fittedOrdinates[i];
+        SSE += residual * residual;
+    }
 
     // Calculates the coefficients of the polynomials of the spline
     coeffD0 = vector<vector<double>>(numberOfPolynomials,vector<double>(m,0));
@@ -821,7 +1061,7 @@ void Spline::calculateCoefficients() {
     for (int a=g; a<g+numberOfPolynomials; ++a) {
         for (int b=firstBasis; b<firstBasis+m; ++b) {
             for (int c=0; c<m; ++c) {
-                coeffD0[a-g][c] += basisFunctions[b].coeffD0[g+firstBasis-b][c]*
+                coeffD0[a-g][c] += basisFunctions.coeffD0(b,g+firstBasis-b)[c]*
                                    splineCoefficients[b];
             }
         }
@@ -835,7 +1075,7 @@ void Spline::calculateCoefficients() {
     for (int a=g; a<g+numberOfPolynomials; ++a) {
         for (int b=firstBasis; b<firstBasis+m; ++b) {
             for (int c=0; c<g; ++c) {
-                coeffD1[a-g][c] += basisFunctions[b].coeffD1[g+firstBasis-b][c]*
+                coeffD1[a-g][c] += basisFunctions.coeffD1(b,g+firstBasis-b)[c]*
                                    splineCoefficients[b];
             }
         }
@@ -849,14 +1089,27 @@ void Spline::calculateCoefficients() {
     for (int a=g; a<g+numberOfPolynomials; ++a) {
         for (int b=firstBasis; b<firstBasis+m; ++b) {
             for (int c=0; c<g-1; ++c) {
-                coeffD2[a-g][c] += basisFunctions[b].coeffD2[g+firstBasis-b][c]*
+                coeffD2[a-g][c] += basisFunctions.coeffD2(b,g+firstBasis-b)[c]*
                                    splineCoefficients[b];
             }
         }
         ++firstBasis;
     }
 
-    // Initializes the 'powers' vector
-    powers = vector<double>(m,1);
+    // Saves the coefficients one polynomial after the other
+    flatCoeffD0 = flatCoefficients(coeffD0);
+    flatCoeffD1 = flatCoefficients(coeffD1);
+    flatCoeffD2 = flatCoefficients(coeffD2);
+
+    // Chooses the kernels evaluating the polynomials
+    kernelD0 = hornerKernel(g);
+    kernelD1 = hornerKernel(g-1);
+    kernelD2 = hornerKernel(g-2);
+
+    // For splines with many polynomials, builds the bucket index with one
+    // bucket per polynomial on average
+    bucketFirstPolynomial.clear();
+    if (numberOfPolynomials >= minimumPolynomialsForBucketIndex)
+        buildBucketIndex(numberOfPolynomials);
 
 }
@@ -4,10 +4,12 @@ import sys
 import os
 import subprocess
 from statistics import mean
+from bisect import bisect_left
 from .CLibrary import CLibrary
 from copy import deepcopy
 
 c_float_p = POINTER(c_double)
+c_int_p = POINTER(c_int)
 
 
 def listToArray(ll):
@@ -18,12 +20,17 @@ class Spline:
     moduleVersion = '_0.0.0.10'
     binariesFileName = f'SplineGenerator{moduleVersion}.o'
     criterion_list = ["AIC", "BIC", "SSE"]
+    lambdaOptimizer_list = ["grid", "brent"]
+    solver_list = ["banded", "demmlerReinsch"]
+    penalty_list = ["integral", "difference"]
     possibleSplineType = [0, 1]
+    # Status of the curves calculated by computeBatch
+    batchStatus_list = ["fitted", "too few points", "invalid data", "output too small", "failed"]
 
     @staticmethod
     def compileBinaries(module_path, compiler='g++'):
         print('Compiling binaries...')
-        flags_compiler = '-std=c++17 -shared -fPIC -O3 -Wall -DNDEBUG'
+        flags_compiler = '-std=c++17 -shared -fPIC -O3 -Wall -DNDEBUG -pthread'
         input_main = os.path.join(module_path, 'main.cpp')
         output_exec = os.path.join(module_path, Spline.binariesFileName)
         subprocess.check_call(f'{compiler} {flags_compiler} {input_main} -o {output_exec}', shell=True)
@@ -47,6 +54,28 @@ class Spline:
             raise ValueError("fractionOfOrdinateRangeForMaximumIdentification cannot be less or equal than zero")
         if self.graphPoints <= 0:
             raise ValueError("graphPoints cannot be less or equal than zero")
+        if self.lambdaOptimizer not in self.lambdaOptimizer_list:
+            raise ValueError("The selected lambdaOptimizer doesn't exist")
+        if self.lambdaTolerance <= 0:
+            raise ValueError("lambdaTolerance cannot be less or equal than zero")
+        if self.maximumLambdaEvaluations < 0:
+            raise ValueError("maximumLambdaEvaluations cannot be less than zero")
+        if self.numberOfStepsLambdaBracket < 2:
+            raise ValueError("numberOfStepsLambdaBracket cannot be less than two")
+        if self.solver not in self.solver_list:
+            raise ValueError("The selected solver doesn't exist")
+        if self.penalty not in self.penalty_list:
+            raise ValueError("The selected penalty doesn't exist")
+        if self.differenceOrder <= 0:
+            raise ValueError("differenceOrder cannot be less or equal than zero")
+        if self.numberOfThreadsLambda <= 0:
+            raise ValueError("numberOfThreadsLambda cannot be less or equal than zero")
+        if len(self.numberOfAbscissaeSeparatingConsecutiveKnots) == 0:
+            raise ValueError("numberOfAbscissaeSeparatingConsecutiveKnots cannot be empty")
+        if any(k < 0 for k in self.numberOfAbscissaeSeparatingConsecutiveKnots):
+            raise ValueError("numberOfAbscissaeSeparatingConsecutiveKnots cannot contain negative values")
+        if self.numberOfThreadsCandidates <= 0:
+            raise ValueError("numberOfThreadsCandidates cannot be less or equal than zero")
 
     def filterInputData(self):
         """
@@ -79,7 +108,11 @@ class Spline:
                  numberOfRatiolkForAICcUse: int = 40, fractionOfOrdinateRangeForAsymptoteIdentification: float = 0.005,
                  fractionOfOrdinateRangeForMaximumIdentification: float = 0.025,
                  possibleNegativeOrdinates: bool = False, removeAsymptotes: bool = False, graphPoints: int = 500,
-                 criterion: str = 'AIC'
+                 criterion: str = 'AIC', lambdaOptimizer: str = 'grid', lambdaTolerance: float = 1e-3,
+                 maximumLambdaEvaluations: int = 30, numberOfStepsLambdaBracket: int = 5, solver: str = 'banded',
+                 numberOfThreadsLambda: int = 1,
+                 numberOfAbscissaeSeparatingConsecutiveKnots: tuple = (0, 2, 5), numberOfThreadsCandidates: int = 1,
+                 penalty: str = 'integral', differenceOrder: int = 2, compute: bool = True
                  ):
         """
 
@@ -96,9 +129,31 @@ class Spline:
         :param fractionOfOrdinateRangeForAsymptoteIdentification:
         :param fractionOfOrdinateRangeForMaximumIdentification:
         :param possibleNegativeOrdinates:
-        :param removeAsymptotes:
+        :param removeAsymptotes: default False. If True, the horizontal asymptotes at the ends of the spline, identified
+        with fractionOfOrdinateRangeForAsymptoteIdentification, are removed after the calculation
         :param graphPoints:
         :param criterion:
+        :param lambdaOptimizer: default 'grid'. 'grid' takes the minimum of GCV1 among the numberOfStepsLambda values of
+        lambda, 'brent' takes it among the numberOfStepsLambdaBracket values of lambda and refines it with Brent's method
+        in log10(lambda)
+        :param lambdaTolerance: tolerance on log10(lambda) of the refinement with Brent's method
+        :param maximumLambdaEvaluations: maximum number of values of lambda evaluated by Brent's method
+        :param numberOfStepsLambdaBracket: default 5. Number of values of lambda of the coarse grid bracketing the minimum
+        for 'brent'
+        :param solver: default 'banded'. 'banded' factorizes the band matrix of the penalized system for each lambda,
+        at a cost linear in the number of basis functions K; 'demmlerReinsch' diagonalizes it once per fit, at a cost
+        cubic in K and with memory quadratic in K, after which each lambda costs K*K. It is never faster than 'banded',
+        and is kept for comparison
+        :param numberOfThreadsLambda: default 1. Number of threads evaluating the numberOfStepsLambda values of lambda
+        concurrently. The result does not depend on it
+        :param numberOfAbscissaeSeparatingConsecutiveKnots: default (0, 2, 5). For each candidate spline, the number of
+        data points between consecutive knots. The best candidate is chosen according to criterion
+        :param numberOfThreadsCandidates: default 1. Number of threads calculating the candidate splines concurrently
+        :param penalty: default 'integral'. 'integral' penalizes the integral of the squared second derivative of the
+        spline, 'difference' the squared differences of order differenceOrder between the coefficients of consecutive
+        basis functions (P-splines), which is cheaper to assemble and suited to splines with many knots
+        :param differenceOrder: default 2. Order of the differences of the 'difference' penalty
+        :param compute: default True. If False, the spline is not calculated by the constructor. Used by computeBatch
         """
         self.module_path = os.path.dirname(sys.modules[self.__module__].__file__)
 
@@ -125,6 +180,19 @@ class Spline:
         self.graphPoints = graphPoints
         self.criterion = criterion
         self.splineType = splineType
+        self.lambdaOptimizer = lambdaOptimizer
+        self.lambdaTolerance = lambdaTolerance
+        self.maximumLambdaEvaluations = maximumLambdaEvaluations
+        self.numberOfStepsLambdaBracket = numberOfStepsLambdaBracket
+        self.solver = solver
+        self.penalty = penalty
+        self.differenceOrder = differenceOrder
+        self.numberOfThreadsLambda = numberOfThreadsLambda
+        self.numberOfAbscissaeSeparatingConsecutiveKnots = list(numberOfAbscissaeSeparatingConsecutiveKnots)
+        self.numberOfThreadsCandidates = numberOfThreadsCandidates
+        self.possibleNegativeOrdinates = possibleNegativeOrdinates
+        # Not called removeAsymptotes, which is the method removing them
+        self.asymptotesRemoval = removeAsymptotes
 
         # Check Settings
         self.checkSettings()
@@ -135,12 +203,25 @@ class Spline:
         self._coeffD0 = None
         self._coeffD1 = None
         self._coeffD2 = None
+        self.numberOfLambdaEvaluations = None
+        self.status = None
 
         # Start
-        self.computeSpline()
+        if compute:
+            self.computeSpline()
 
-        if not possibleNegativeOrdinates:
-            self.removeNegativeSegments()
+            if removeAsymptotes:
+                self.removeAsymptotes()
+
+            if not possibleNegativeOrdinates:
+                self.removeNegativeSegments()
+
+    def maximumNumberOfKnots(self):
+        # For models, points are added where the data are sparse: up to 31 points in total if there are less than 30
+        # of them, otherwise at most one point for each mean distance between consecutive data points
+        if self.splineType == 1:
+            return max(2 * len(self.x), 32)
+        return len(self.x)
 
     def computeSpline(self):
         try:
@@ -167,46 +248,76 @@ class Spline:
                                                  c_double,  # fractionOfOrdinateRangeForMaximumIdentification
                                                  c_int,  # graphPoints
                                                  c_char_p,  # criterion
+                                                 c_char_p,  # lambdaOptimizer
+                                                 c_double,  # lambdaTolerance
+                                                 c_int,  # maximumLambdaEvaluations
+                                                 c_int,  # numberOfStepsLambdaBracket
+                                                 c_char_p,  # solver
+                                                 c_char_p,  # penalty
+                                                 c_int,  # differenceOrder
+                                                 c_int,  # numberOfThreadsLambda
+                                                 c_int_p,  # numberOfAbscissaeSeparatingConsecutiveKnots
+                                                 c_int,  # number of candidates
+                                                 c_int,  # numberOfThreadsCandidates
+                                                 c_int_p,  # numberOfLambdaEvaluations
                                                  ]
 
         c_library.compute_spline_cpp.restype = c_int
 
         x_c = listToArray(self.x)
         y_c = listToArray(self.y)
+        candidates_c = (c_int * len(self.numberOfAbscissaeSeparatingConsecutiveKnots))(
+            *self.numberOfAbscissaeSeparatingConsecutiveKnots)
         # TODO se non cambiano i nodi (tolti o aggiunti) si può conoscere numberOfKnots e si può togliere!
         numberOfKnots_c = c_int()
         numberOfPolynomials_c = c_int()
+        numberOfLambdaEvaluations_c = c_int()
 
-        size_coeff_matrix = (len(self.x) * self._m)
-        size_knots = len(self.x)
+        size_coeff_matrix = (self.maximumNumberOfKnots() * self._m)
+        size_knots = self.maximumNumberOfKnots()
 
         coeffD0_c = (size_coeff_matrix * c_double)()
         coeffD1_c = (size_coeff_matrix * c_double)()
         coeffD2_c = (size_coeff_matrix * c_double)()
         knots_c = (size_knots * c_double)()
 
-        c_library.compute_spline_cpp(x_c,  # x
-                                     y_c,  # y
-                                     c_int(len(self.x)),  # length of x, y
-                                     c_int(self.splineType),  # splineType
-                                     pointer(numberOfKnots_c),  # numberOfKnots
-                                     pointer(numberOfPolynomials_c),  # numberOfPolynomials
-                                     pointer(coeffD0_c),  # coeffDO
-                                     pointer(coeffD1_c),  # coeffD1
-                                     pointer(coeffD2_c),  # coeffD2
-                                     pointer(knots_c),  # knots
-                                     c_bool(self.verbose),  # verbose
-                                     c_int(self._g),  # g
-                                     c_int(self.lambdaSearchInterval),  # lambdaSearchInterval
-                                     c_int(self.numberOfStepsLambda),  # numberOfStepsLambda
-                                     c_int(self.numberOfRatiolkForAICcUse),  # numberOfRatiolkForAICcUse
-                                     c_double(self.fractionOfOrdinateRangeForAsymptoteIdentification),
-                                     c_double(self.fractionOfOrdinateRangeForMaximumIdentification),
-                                     c_int(self.graphPoints),  # graphPoints
-                                     c_char_p(self.criterion.encode('utf-8')),  # criterion
-                                     )
+        status = c_library.compute_spline_cpp(x_c,  # x
+                                              y_c,  # y
+                                              c_int(len(self.x)),  # length of x, y
+                                              c_int(self.splineType),  # splineType
+                                              pointer(numberOfKnots_c),  # numberOfKnots
+                                              pointer(numberOfPolynomials_c),  # numberOfPolynomials
+                                              pointer(coeffD0_c),  # coeffDO
+                                              pointer(coeffD1_c),  # coeffD1
+                                              pointer(coeffD2_c),  # coeffD2
+                                              pointer(knots_c),  # knots
+                                              c_bool(self.verbose),  # verbose
+                                              c_int(self._g),  # g
+                                              c_int(self.lambdaSearchInterval),  # lambdaSearchInterval
+                                              c_int(self.numberOfStepsLambda),  # numberOfStepsLambda
+                                              c_int(self.numberOfRatiolkForAICcUse),  # numberOfRatiolkForAICcUse
+                                              c_double(self.fractionOfOrdinateRangeForAsymptoteIdentification),
+                                              c_double(self.fractionOfOrdinateRangeForMaximumIdentification),
+                                              c_int(self.graphPoints),  # graphPoints
+                                              c_char_p(self.criterion.encode('utf-8')),  # criterion
+                                              c_char_p(self.lambdaOptimizer.encode('utf-8')),  # lambdaOptimizer
+                                              c_double(self.lambdaTolerance),  # lambdaTolerance
+                                              c_int(self.maximumLambdaEvaluations),  # maximumLambdaEvaluations
+                                              c_int(self.numberOfStepsLambdaBracket),  # numberOfStepsLambdaBracket
+                                              c_char_p(self.solver.encode('utf-8')),  # solver
+                                              c_char_p(self.penalty.encode('utf-8')),  # penalty
+                                              c_int(self.differenceOrder),  # differenceOrder
+                                              c_int(self.numberOfThreadsLambda),  # numberOfThreadsLambda
+                                              candidates_c,  # numberOfAbscissaeSeparatingConsecutiveKnots
+                                              c_int(len(self.numberOfAbscissaeSeparatingConsecutiveKnots)),  # candidates
+                                              c_int(self.numberOfThreadsCandidates),  # numberOfThreadsCandidates
+                                              pointer(numberOfLambdaEvaluations_c),  # numberOfLambdaEvaluations
+                                              )
+        if status != 0:
+            raise ValueError("The c++ library rejected the settings")
 
         self._numberOfPolynomials = numberOfPolynomials_c.value
+        self.numberOfLambdaEvaluations = numberOfLambdaEvaluations_c.value
         self._coeffD0 = np.reshape(np.array(deepcopy(coeffD0_c[0: self._m * self._numberOfPolynomials])),
                                   (self._numberOfPolynomials, self._m))
         self._coeffD1 = np.reshape(np.array(deepcopy(coeffD1_c[0: self._m * self._numberOfPolynomials])),
@@ -218,8 +329,10 @@ class Spline:
         # Free Memory
         del x_c
         del y_c
+        del candidates_c
         del numberOfKnots_c
         del numberOfPolynomials_c
+        del numberOfLambdaEvaluations_c
         del coeffD0_c
         del coeffD1_c
         del coeffD2_c
@@ -227,15 +340,215 @@ class Spline:
 
         del c_library
 
+    @classmethod
+    def computeBatch(cls, curves, numberOfThreads: int = 1, **kwargs):
+        """
+        Calculates the splines of many curves with a single call of the c++ library. The curves are shared among
+        numberOfThreads threads, and a curve which cannot be calculated does not stop the others
+        :param curves: list of (x, y) pairs or of (x, y, splineType) triples
+        :param numberOfThreads: default 1. Number of threads among which the curves are shared
+        :param kwargs: settings of the splines, as in the constructor. numberOfThreadsLambda and
+        numberOfThreadsCandidates are ignored
+        :return: list of Spline, one for each curve. The status attribute of each Spline is its index in
+        batchStatus_list: 0 if the spline was calculated, otherwise the spline has no coefficients
+        """
+        if numberOfThreads <= 0:
+            raise ValueError("numberOfThreads cannot be less or equal than zero")
+
+        splines = []
+        for curve in curves:
+            settings = dict(kwargs)
+            if len(curve) == 3:
+                settings['splineType'] = curve[2]
+            splines.append(cls(curve[0], curve[1], compute=False, **settings))
+
+        if len(splines) == 0:
+            return splines
+
+        first = splines[0]
+
+        try:
+            c_library = CLibrary(os.path.join(first.module_path, first.binariesFileName))
+        except OSError:
+            raise OSError("Unable to load the system C library")
+
+        c_library.compute_splines_batch.argtypes = [c_int,  # numberOfCurves
+                                                    c_float_p,  # x
+                                                    c_float_p,  # y
+                                                    c_int_p,  # offsets
+                                                    c_int_p,  # splineTypes
+                                                    c_int_p,  # knotsOffsets
+                                                    c_int_p,  # numberOfKnots
+                                                    c_int_p,  # numberOfPolynomials
+                                                    c_float_p,  # coeffDO
+                                                    c_float_p,  # coeffD1
+                                                    c_float_p,  # coeffD2
+                                                    c_float_p,  # knots
+                                                    c_int_p,  # numberOfLambdaEvaluations
+                                                    c_int_p,  # status
+                                                    c_int,  # numberOfThreads
+                                                    c_int,  # g
+                                                    c_int,  # lambdaSearchInterval
+                                                    c_int,  # numberOfStepsLambda
+                                                    c_int,  # numberOfRatiolkForAICcUse
+                                                    c_double,  # fractionOfOrdinateRangeForAsymptoteIdentification
+                                                    c_double,  # fractionOfOrdinateRangeForMaximumIdentification
+                                                    c_int,  # graphPoints
+                                                    c_char_p,  # criterion
+                                                    c_char_p,  # lambdaOptimizer
+                                                    c_double,  # lambdaTolerance
+                                                    c_int,  # maximumLambdaEvaluations
+                                                    c_int,  # numberOfStepsLambdaBracket
+                                                    c_char_p,  # solver
+                                                    c_char_p,  # penalty
+                                                    c_int,  # differenceOrder
+                                                    c_int_p,  # numberOfAbscissaeSeparatingConsecutiveKnots
+                                                    c_int,  # number of candidates
+                                                    ]
+
+        c_library.compute_splines_batch.restype = c_int
+
+        # The data points of all the curves are concatenated, and curve i starts from offsets[i]. The knots of curve
+        # i start from knotsOffsets[i], and its coefficients from knotsOffsets[i] * m
+        x, y, offsets, knotsOffsets = [], [], [0], [0]
+        for spline in splines:
+            x += spline.x
+            y += spline.y
+            offsets.append(len(x))
+            knotsOffsets.append(knotsOffsets[-1] + spline.maximumNumberOfKnots())
+
+        numberOfCurves = len(splines)
+        m = first._m
+
+        x_c = listToArray(x)
+        y_c = listToArray(y)
+        offsets_c = (c_int * len(offsets))(*offsets)
+        splineTypes_c = (c_int * numberOfCurves)(*[spline.splineType for spline in splines])
+        knotsOffsets_c = (c_int * len(knotsOffsets))(*knotsOffsets)
+        candidates_c = (c_int * len(first.numberOfAbscissaeSeparatingConsecutiveKnots))(
+            *first.numberOfAbscissaeSeparatingConsecutiveKnots)
+
+        numberOfKnots_c = (c_int * numberOfCurves)()
+        numberOfPolynomials_c = (c_int * numberOfCurves)()
+        numberOfLambdaEvaluations_c = (c_int * numberOfCurves)()
+        status_c = (c_int * numberOfCurves)()
+
+        coeffD0_c = (knotsOffsets[-1] * m * c_double)()
+        coeffD1_c = (knotsOffsets[-1] * m * c_double)()
+        coeffD2_c = (knotsOffsets[-1] * m * c_double)()
+        knots_c = (knotsOffsets[-1] * c_double)()
+
+        numberOfFailures = c_library.compute_splines_batch(c_int(numberOfCurves),  # numberOfCurves
+                                                           x_c,  # x
+                                                           y_c,  # y
+                                                           offsets_c,  # offsets
+                                                           splineTypes_c,  # splineTypes
+                                                           knotsOffsets_c,  # knotsOffsets
+                                                           numberOfKnots_c,  # numberOfKnots
+                                                           numberOfPolynomials_c,  # numberOfPolynomials
+                                                           coeffD0_c,  # coeffDO
+                                                           coeffD1_c,  # coeffD1
+                                                           coeffD2_c,  # coeffD2
+                                                           knots_c,  # knots
+                                                           numberOfLambdaEvaluations_c,  # numberOfLambdaEvaluations
+                                                           status_c,  # status
+                                                           c_int(numberOfThreads),  # numberOfThreads
+                                                           c_int(first._g),  # g
+                                                           c_int(first.lambdaSearchInterval),  # lambdaSearchInterval
+                                                           c_int(first.numberOfStepsLambda),  # numberOfStepsLambda
+                                                           c_int(first.numberOfRatiolkForAICcUse),  # numberOfRatiolkForAICcUse
+                                                           c_double(first.fractionOfOrdinateRangeForAsymptoteIdentification),
+                                                           c_double(first.fractionOfOrdinateRangeForMaximumIdentification),
+                                                           c_int(first.graphPoints),  # graphPoints
+                                                           c_char_p(first.criterion.encode('utf-8')),  # criterion
+                                                           c_char_p(first.lambdaOptimizer.encode('utf-8')),  # lambdaOptimizer
+                                                           c_double(first.lambdaTolerance),  # lambdaTolerance
+                                                           c_int(first.maximumLambdaEvaluations),  # maximumLambdaEvaluations
+                                                           c_int(first.numberOfStepsLambdaBracket),  # numberOfStepsLambdaBracket
+                                                           c_char_p(first.solver.encode('utf-8')),  # solver
+                                                           c_char_p(first.penalty.encode('utf-8')),  # penalty
+                                                           c_int(first.differenceOrder),  # differenceOrder
+                                                           candidates_c,  # numberOfAbscissaeSeparatingConsecutiveKnots
+                                                           c_int(len(first.numberOfAbscissaeSeparatingConsecutiveKnots)),  # candidates
+                                                           )
+        if numberOfFailures < 0:
+            raise ValueError("The c++ library rejected the settings")
+
+        for i, spline in enumerate(splines):
+            spline.status = status_c[i]
+            if spline.status != 0:
+                continue
+            numberOfPolynomials = numberOfPolynomials_c[i]
+            start = knotsOffsets[i] * m
+            end = start + m * numberOfPolynomials
+            spline._numberOfPolynomials = numberOfPolynomials
+            spline.numberOfLambdaEvaluations = numberOfLambdaEvaluations_c[i]
+            spline._coeffD0 = np.reshape(np.array(coeffD0_c[start: end]), (numberOfPolynomials, m))
+            spline._coeffD1 = np.reshape(np.array(coeffD1_c[start: end]), (numberOfPolynomials, m))
+            spline._coeffD2 = np.reshape(np.array(coeffD2_c[start: end]), (numberOfPolynomials, m))
+            spline._knots = np.array(knots_c[knotsOffsets[i]: knotsOffsets[i] + numberOfKnots_c[i]])
+
+            if spline.asymptotesRemoval:
+                spline.removeAsymptotes()
+
+            if not spline.possibleNegativeOrdinates:
+                spline.removeNegativeSegments()
+
+        # Free Memory
+        del x_c, y_c, offsets_c, splineTypes_c, knotsOffsets_c, candidates_c
+        del numberOfKnots_c, numberOfPolynomials_c, numberOfLambdaEvaluations_c, status_c
+        del coeffD0_c, coeffD1_c, coeffD2_c, knots_c
+
+        del c_library
+
+        return splines
+
+    @classmethod
+    def workspaceStatistics(cls):
+        """
+        Reads the counters of the workspaces used by the c++ library for the temporaries of the fits. Each thread
+        reuses its own workspace, so numberOfFitsWithAllocations stops increasing once the workspaces have grown to
+        the size of the data. numberOfAllocations counts the members of the workspaces whose memory grew during a fit,
+        the knots and the polynomials of the splines being results
+        :return: dict with numberOfFits, numberOfFitsWithAllocations, numberOfAllocations and reservedBytes
+        """
+        module_path = os.path.dirname(sys.modules[cls.__module__].__file__)
+
+        try:
+            c_library = CLibrary(os.path.join(module_path, cls.binariesFileName))
+        except OSError:
+            raise OSError("Unable to load the system C library")
+
+        c_library.spline_workspace_statistics.argtypes = [POINTER(c_long),  # numberOfFits
+                                                          POINTER(c_long),  # numberOfFitsWithAllocations
+                                                          POINTER(c_long),  # numberOfAllocations
+                                                          POINTER(c_long),  # reservedBytes
+                                                          ]
+        c_library.spline_workspace_statistics.restype = None
+
+        numberOfFits_c = c_long()
+        numberOfFitsWithAllocations_c = c_long()
+        numberOfAllocations_c = c_long()
+        reservedBytes_c = c_long()
+
+        c_library.spline_workspace_statistics(pointer(numberOfFits_c),
+                                              pointer(numberOfFitsWithAllocations_c),
+                                              pointer(numberOfAllocations_c),
+                                              pointer(reservedBytes_c))
+
+        statistics = {'numberOfFits': numberOfFits_c.value,
+                      'numberOfFitsWithAllocations': numberOfFitsWithAllocations_c.value,
+                      'numberOfAllocations': numberOfAllocations_c.value,
+                      'reservedBytes': reservedBytes_c.value}
+
+        del c_library
+
+        return statistics
+
     def compute(self, x, k, coeff):
         # TODO ctyhon immplementation?
-        indexOfPolynomial = 0
-
-        for i in range(0, len(self._knots) - 1):
-            if x > self._knots[i]:
-                indexOfPolynomial = i
-            else:
-                break
+        # Last polynomial whose left knot is smaller than x, or the first one
+        indexOfPolynomial = max(bisect_left(self._knots, x, 0, len(self._knots) - 1) - 1, 0)
 
         powers = [1] * k
 
@@ -248,12 +561,50 @@ class Spline:
 
         return y_val
 
+    def evaluateArray(self, x, degree, coeff):
+        try:
+            c_library = CLibrary(os.path.join(self.module_path, self.binariesFileName))
+        except OSError:
+            raise OSError("Unable to load the system C library")
+
+        c_library.evaluate_spline.argtypes = [c_float_p,  # knots
+                                              c_int,  # numberOfKnots
+                                              c_float_p,  # coefficients
+                                              c_int,  # stride
+                                              c_int,  # degree
+                                              c_float_p,  # x
+                                              c_int,  # numberOfPoints
+                                              c_float_p,  # y
+                                              ]
+
+        c_library.evaluate_spline.restype = c_int
+
+        knots = np.ascontiguousarray(self._knots, dtype=np.float64)
+        coefficients = np.ascontiguousarray(coeff, dtype=np.float64)
+        x_flat = np.ascontiguousarray(x, dtype=np.float64).ravel()
+        y_flat = np.empty_like(x_flat)
+
+        c_library.evaluate_spline(knots.ctypes.data_as(c_float_p),  # knots
+                                  c_int(len(knots)),  # numberOfKnots
+                                  coefficients.ctypes.data_as(c_float_p),  # coefficients
+                                  c_int(coefficients.shape[1]),  # stride
+                                  c_int(degree),  # degree
+                                  x_flat.ctypes.data_as(c_float_p),  # x
+                                  c_int(len(x_flat)),  # numberOfPoints
+                                  y_flat.ctypes.data_as(c_float_p),  # y
+                                  )
+
+        del c_library
+
+        return y_flat.reshape(np.shape(x))
+
     def evaluate(self, x, der: int = 0):
         """
         TODO set warning if outside abscissae range
         :param x: x could be a float or int number or a list of them. evaluate the derivative of the spline in x.
+        A numpy array is evaluated by the c++ library, much faster than a list
         :param der: default 0. 0 means D0, 1 means D1 (first derivative), 2 means D2 (second derivative)
-        :return: the evaluated derivative on the x-value(s) x
+        :return: the evaluated derivative on the x-value(s) x, as a numpy array if x is a numpy array
         """
         if not any([len(self._knots), self._m, self._coeffD0, self._coeffD1, self._coeffD2]):
             raise ValueError('Spline is not computed yet!')
@@ -271,104 +622,412 @@ class Spline:
             coeff = self._coeffD2
         else:
             raise ValueError('Derivative does not exists!')
+        if isinstance(x, np.ndarray):
+            return self.evaluateArray(x, k - 1, coeff)
         return self.compute(x, k, coeff) if not hasattr(x, '__iter__') else [self.compute(e, k, coeff) for e in x]
 
-    def removeAsymptotes(self):
+    def sample(self, start=None, end=None, numberOfPoints: int = 1000):
+        """
+        Evaluates the spline and its first and second derivatives on a grid of equally spaced points
+        :param start: first point of the grid, default the first knot
+        :param end: last point of the grid, default the last knot. It can be smaller than start
+        :param numberOfPoints: number of points of the grid
+        :return: the grid and the evaluated D0, D1 and D2 on it, as numpy arrays
+        """
+        if self._knots is None or not len(self._knots):
+            raise ValueError('Spline is not computed yet!')
+        start = self._knots[0] if start is None else start
+        end = self._knots[-1] if end is None else end
+        step = (end - start) / (numberOfPoints - 1) if numberOfPoints > 1 else 0.0
+
+        try:
+            c_library = CLibrary(os.path.join(self.module_path, self.binariesFileName))
+        except OSError:
+            raise OSError("Unable to load the system C library")
+
+        c_library.sample_spline.argtypes = [c_float_p,  # knots
+                                            c_int,  # numberOfKnots
+                                            c_float_p,  # coefficients
+                                            c_int,  # stride
+                                            c_int,  # degree
+                                            c_double,  # start
+                                            c_double,  # step
+                                            c_int,  # numberOfPoints
+                                            c_float_p,  # d0
+                                            c_float_p,  # d1
+                                            c_float_p,  # d2
+                                            ]
 
-        return
+        c_library.sample_spline.restype = c_int
 
-        # TODO serve davvero?
+        knots = np.ascontiguousarray(self._knots, dtype=np.float64)
+        coefficients = np.ascontiguousarray(self._coeffD0, dtype=np.float64)
+        d0 = np.empty(numberOfPoints)
+        d1 = np.empty(numberOfPoints)
+        d2 = np.empty(numberOfPoints)
 
-        # Evaluations of polynomials left and right
+        c_library.sample_spline(knots.ctypes.data_as(c_float_p),  # knots
+                                c_int(len(knots)),  # numberOfKnots
+                                coefficients.ctypes.data_as(c_float_p),  # coefficients
+                                c_int(coefficients.shape[1]),  # stride
+                                c_int(self._g),  # degree
+                                c_double(start),  # start
+                                c_double(step),  # step
+                                c_int(numberOfPoints),  # numberOfPoints
+                                d0.ctypes.data_as(c_float_p),  # d0
+                                d1.ctypes.data_as(c_float_p),  # d1
+                                d2.ctypes.data_as(c_float_p),  # d2
+                                )
 
-        x_range = np.linspace(min(self.originalX), max(self.originalX), 100)
-        y_eval = self.evaluate(x_range, der=0)
+        del c_library
 
-        self.yD0range = max(y_eval) - min(y_eval)
-        minVariation = self.yD0range * self.fractionOfOrdinateRangeForAsymptoteIdentification
-        numberAsymptotesPolynomialsLeft = 0
-        numberAsymptotesPolynomialsRight = 0
-        yFront = self.evaluate(self.knots[0], der=0)
-        yBack = self.evaluate(self.knots[-1], der=0)
+        x = start + step * np.arange(numberOfPoints)
+        return x, d0, d1, d2
 
-        for i in range(1, len(self.knots)):
-            y = self.evaluate(self.knots[i], der=0)
-            if abs(yFront - y) < minVariation:
-                numberAsymptotesPolynomialsLeft += 1
-            else:
+    def roots(self, der: int = 0):
+        """
+        Calculates the real roots of the spline or of one of its derivatives, inside the range of the knots
+        :param der: default 0. 0 means D0, 1 means D1 (first derivative), 2 means D2 (second derivative)
+        :return: a numpy array with the roots sorted from smallest to largest
+        """
+        if self._knots is None or not len(self._knots):
+            raise ValueError('Spline is not computed yet!')
+        if der == 0:
+            coeff = self._coeffD0
+        elif der == 1:
+            coeff = self._coeffD1
+        elif der == 2:
+            coeff = self._coeffD2
+        else:
+            raise ValueError('Derivative does not exists!')
+
+        try:
+            c_library = CLibrary(os.path.join(self.module_path, self.binariesFileName))
+        except OSError:
+            raise OSError("Unable to load the system C library")
+
+        c_library.calculate_roots.argtypes = [c_float_p,  # knots
+                                              c_int,  # numberOfKnots
+                                              c_float_p,  # coefficients
+                                              c_int,  # stride
+                                              c_int,  # degree
+                                              c_float_p,  # roots
+                                              c_int,  # maximumNumberOfRoots
+                                              c_int_p,  # numberOfRoots
+                                              ]
+
+        c_library.calculate_roots.restype = c_int
+
+        knots = np.ascontiguousarray(self._knots, dtype=np.float64)
+        coefficients = np.ascontiguousarray(coeff, dtype=np.float64)
+        maximumNumberOfRoots = (len(knots) - 1) * max(self._g - der, 0) + 1
+        numberOfRoots = c_int()
+
+        while True:
+            roots = np.empty(maximumNumberOfRoots)
+            status = c_library.calculate_roots(knots.ctypes.data_as(c_float_p),  # knots
+                                               c_int(len(knots)),  # numberOfKnots
+                                               coefficients.ctypes.data_as(c_float_p),  # coefficients
+                                               c_int(coefficients.shape[1]),  # stride
+                                               c_int(self._g - der),  # degree
+                                               roots.ctypes.data_as(c_float_p),  # roots
+                                               c_int(maximumNumberOfRoots),  # maximumNumberOfRoots
+                                               pointer(numberOfRoots),  # numberOfRoots
+                                               )
+            # If the roots do not fit, numberOfRoots contains their number
+            if status == 0 or numberOfRoots.value <= maximumNumberOfRoots:
                 break
+            maximumNumberOfRoots = numberOfRoots.value
 
-        for i in range(len(self.knots) - 2, 0, -1):
-            y = self.evaluate(self.knots[i], der=0)
-            if abs(yBack - y) < minVariation:
-                numberAsymptotesPolynomialsRight += 1
-            else:
+        del c_library
+
+        if status != 0:
+            raise ValueError('Unable to calculate the roots of the spline')
+
+        return roots[:numberOfRoots.value].copy()
+
+    def extrema(self):
+        """
+        Finds the local maxima and minima of the spline, inside the range of the knots. A maximum is well-defined if,
+        on both sides, it is higher than the lowest point between it and the nearest higher maximum, or the end of the
+        spline, by at least fractionOfOrdinateRangeForMaximumIdentification times the range of the spline on the y-axis
+        :return: numpy arrays with the abscissae, the ordinates and the types of the extrema (0: minimum, 1: maximum,
+        2: well-defined maximum), sorted along the x-axis
+        """
+        if self._knots is None or not len(self._knots):
+            raise ValueError('Spline is not computed yet!')
+
+        try:
+            c_library = CLibrary(os.path.join(self.module_path, self.binariesFileName))
+        except OSError:
+            raise OSError("Unable to load the system C library")
+
+        c_library.find_extrema.argtypes = [c_float_p,  # knots
+                                           c_int,  # numberOfKnots
+                                           c_float_p,  # coeffD0
+                                           c_float_p,  # coeffD1
+                                           c_float_p,  # coeffD2
+                                           c_int,  # stride
+                                           c_int,  # degree
+                                           c_double,  # fractionOfOrdinateRangeForMaximumIdentification
+                                           c_int,  # maximumNumberOfExtrema
+                                           c_float_p,  # abscissae
+                                           c_float_p,  # ordinates
+                                           c_int_p,  # types
+                                           c_int_p,  # numberOfExtrema
+                                           ]
+
+        c_library.find_extrema.restype = c_int
+
+        knots = np.ascontiguousarray(self._knots, dtype=np.float64)
+        coeffD0 = np.ascontiguousarray(self._coeffD0, dtype=np.float64)
+        coeffD1 = np.ascontiguousarray(self._coeffD1, dtype=np.float64)
+        coeffD2 = np.ascontiguousarray(self._coeffD2, dtype=np.float64)
+        # Each polynomial of the first derivative has at most g-1 roots, plus one for each knot
+        maximumNumberOfExtrema = (len(knots) - 1) * self._g + 1
+        numberOfExtrema = c_int()
+
+        while True:
+            abscissae = np.empty(maximumNumberOfExtrema)
+            ordinates = np.empty(maximumNumberOfExtrema)
+            types = np.empty(maximumNumberOfExtrema, dtype=np.intc)
+            status = c_library.find_extrema(knots.ctypes.data_as(c_float_p),  # knots
+                                            c_int(len(knots)),  # numberOfKnots
+                                            coeffD0.ctypes.data_as(c_float_p),  # coeffD0
+                                            coeffD1.ctypes.data_as(c_float_p),  # coeffD1
+                                            coeffD2.ctypes.data_as(c_float_p),  # coeffD2
+                                            c_int(self._m),  # stride
+                                            c_int(self._g),  # degree
+                                            c_double(self.fractionOfOrdinateRangeForMaximumIdentification),  # fractionOfOrdinateRangeForMaximumIdentification
+                                            c_int(maximumNumberOfExtrema),  # maximumNumberOfExtrema
+                                            abscissae.ctypes.data_as(c_float_p),  # abscissae
+                                            ordinates.ctypes.data_as(c_float_p),  # ordinates
+                                            types.ctypes.data_as(c_int_p),  # types
+                                            pointer(numberOfExtrema),  # numberOfExtrema
+                                            )
+            # If the extrema do not fit, numberOfExtrema contains their number
+            if status == 0 or numberOfExtrema.value <= maximumNumberOfExtrema:
                 break
+            maximumNumberOfExtrema = numberOfExtrema.value
+
+        del c_library
+
+        if status != 0:
+            raise ValueError('Unable to calculate the extrema of the spline')
+
+        n = numberOfExtrema.value
+        return abscissae[:n].copy(), ordinates[:n].copy(), types[:n].copy()
+
+    def distance(self, other, normalization: str = 'none', divideByDomainLength: bool = True):
+        """
+        Calculates the L2 distances between this spline, typically the experimental one, and other, typically a model,
+        and between their first derivatives, on the intersection of their domains. The integrals of the squared
+        differences are calculated exactly, without sampling
+        :param other: Spline to compare with
+        :param normalization: default 'none'. 'reference' divides both splines by the largest absolute ordinate of this
+        spline on the intersection, 'individual' divides each spline by its own. The derivatives are divided by the same
+        factors
+        :param divideByDomainLength: default True. If True, the integrals are divided by the length of the intersection,
+        so that the distances are root mean squares
+        :return: the distances between the splines and between their first derivatives
+        """
+        if self._knots is None or not len(self._knots) or other._knots is None or not len(other._knots):
+            raise ValueError('Spline is not computed yet!')
+        if normalization not in ('none', 'reference', 'individual'):
+            raise ValueError("normalization must be 'none', 'reference' or 'individual'")
+
+        try:
+            c_library = CLibrary(os.path.join(self.module_path, self.binariesFileName))
+        except OSError:
+            raise OSError("Unable to load the system C library")
 
-        # REMOVING THE ASYMPTOTES
-
-        # If the spline is completely flat, doesn't remove any segment
-        if numberAsymptotesPolynomialsLeft == self.numberOfPolynomials:
-            return
-        # If there are no horizontal asymptotes, doesn't remove any segment
-        elif numberAsymptotesPolynomialsLeft + numberAsymptotesPolynomialsRight == 0:
-            return
-        elif numberAsymptotesPolynomialsLeft < self.numberOfPolynomials - numberAsymptotesPolynomialsRight:
-            newKnots = np.array([])
-            newCoeffD0 = np.array([])
-            newCoeffD1 = np.array([])
-            newCoeffD2 = np.array([])
-            print('dooo', numberAsymptotesPolynomialsLeft, self.numberOfPolynomials, numberAsymptotesPolynomialsRight)
-
-            for i in range(numberAsymptotesPolynomialsLeft,
-                           self.numberOfPolynomials - numberAsymptotesPolynomialsRight):
-                newKnots = np.append(newKnots, self.knots[i])
-                newCoeffD0 = np.append(newCoeffD0, self.coeffD0[i])
-                newCoeffD1 = np.append(newCoeffD1, self.coeffD1[i])
-                newCoeffD2 = np.append(newCoeffD2, self.coeffD2[i])
-
-            newKnots = np.append(newKnots, self.knots[self.numberOfPolynomials - numberAsymptotesPolynomialsRight])
-
-            self.knots = newKnots
-            self.coeffD0 = newCoeffD0
-            self.coeffD1 = newCoeffD1
-            self.coeffD2 = newCoeffD2
-            self.numberOfPolynomials = len(self.knots) - 1
-
-            print(self.coeffD0)
+        c_library.spline_distance.argtypes = [c_float_p,  # knotsA
+                                              c_int,  # numberOfKnotsA
+                                              c_float_p,  # coeffD0A
+                                              c_float_p,  # coeffD1A
+                                              c_int,  # strideA
+                                              c_int,  # degreeA
+                                              c_float_p,  # knotsB
+                                              c_int,  # numberOfKnotsB
+                                              c_float_p,  # coeffD0B
+                                              c_float_p,  # coeffD1B
+                                              c_int,  # strideB
+                                              c_int,  # degreeB
+                                              c_char_p,  # normalization
+                                              c_bool,  # divideByDomainLength
+                                              c_float_p,  # distanceD0
+                                              c_float_p,  # distanceD1
+                                              ]
+
+        c_library.spline_distance.restype = c_int
+
+        knotsA = np.ascontiguousarray(self._knots, dtype=np.float64)
+        coeffD0A = np.ascontiguousarray(self._coeffD0, dtype=np.float64)
+        coeffD1A = np.ascontiguousarray(self._coeffD1, dtype=np.float64)
+        knotsB = np.ascontiguousarray(other._knots, dtype=np.float64)
+        coeffD0B = np.ascontiguousarray(other._coeffD0, dtype=np.float64)
+        coeffD1B = np.ascontiguousarray(other._coeffD1, dtype=np.float64)
+        distanceD0 = c_double()
+        distanceD1 = c_double()
+
+        status = c_library.spline_distance(knotsA.ctypes.data_as(c_float_p),  # knotsA
+                                           c_int(len(knotsA)),  # numberOfKnotsA
+                                           coeffD0A.ctypes.data_as(c_float_p),  # coeffD0A
+                                           coeffD1A.ctypes.data_as(c_float_p),  # coeffD1A
+                                           c_int(self._m),  # strideA
+                                           c_int(self._g),  # degreeA
+                                           knotsB.ctypes.data_as(c_float_p),  # knotsB
+                                           c_int(len(knotsB)),  # numberOfKnotsB
+                                           coeffD0B.ctypes.data_as(c_float_p),  # coeffD0B
+                                           coeffD1B.ctypes.data_as(c_float_p),  # coeffD1B
+                                           c_int(other._m),  # strideB
+                                           c_int(other._g),  # degreeB
+                                           c_char_p(normalization.encode('utf-8')),  # normalization
+                                           c_bool(divideByDomainLength),  # divideByDomainLength
+                                           pointer(distanceD0),  # distanceD0
+                                           pointer(distanceD1),  # distanceD1
+                                           )
+
+        del c_library
+
+        if status != 0:
+            raise ValueError('The domains of the splines do not intersect, or a spline to be normalized is 0')
+
+        return distanceD0.value, distanceD1.value
+
+    def removeAsymptotes(self):
+        """
+        Removes the horizontal asymptotes at the ends of the spline: the leading and trailing intervals inside which the
+        spline stays within a horizontal area as high as fractionOfOrdinateRangeForAsymptoteIdentification times its
+        range on the y-axis. A spline which is all asymptote is kept whole
+        """
+        try:
+            c_library = CLibrary(os.path.join(self.module_path, self.binariesFileName))
+        except OSError:
+            raise OSError("Unable to load the system C library")
+
+        c_library.remove_asymptotes.argtypes = [c_float_p,  # knots
+                                                c_int,  # numberOfKnots
+                                                c_float_p,  # coeffD0
+                                                c_float_p,  # coeffD1
+                                                c_float_p,  # coeffD2
+                                                c_int,  # stride
+                                                c_int,  # degree
+                                                c_double,  # fractionOfOrdinateRangeForAsymptoteIdentification
+                                                c_float_p,  # newKnots
+                                                c_float_p,  # newCoeffD0
+                                                c_float_p,  # newCoeffD1
+                                                c_float_p,  # newCoeffD2
+                                                c_int_p,  # newNumberOfKnots
+                                                ]
+
+        c_library.remove_asymptotes.restype = c_int
+
+        knots = np.ascontiguousarray(self._knots, dtype=np.float64)
+        coeffD0 = np.ascontiguousarray(self._coeffD0, dtype=np.float64)
+        coeffD1 = np.ascontiguousarray(self._coeffD1, dtype=np.float64)
+        coeffD2 = np.ascontiguousarray(self._coeffD2, dtype=np.float64)
+        # The knots are only removed
+        newKnots = np.empty(len(knots))
+        newCoeffD0 = np.empty((len(knots) - 1, self._m))
+        newCoeffD1 = np.empty((len(knots) - 1, self._m))
+        newCoeffD2 = np.empty((len(knots) - 1, self._m))
+        newNumberOfKnots = c_int()
+
+        status = c_library.remove_asymptotes(knots.ctypes.data_as(c_float_p),  # knots
+                                             c_int(len(knots)),  # numberOfKnots
+                                             coeffD0.ctypes.data_as(c_float_p),  # coeffD0
+                                             coeffD1.ctypes.data_as(c_float_p),  # coeffD1
+                                             coeffD2.ctypes.data_as(c_float_p),  # coeffD2
+                                             c_int(self._m),  # stride
+                                             c_int(self._g),  # degree
+                                             c_double(self.fractionOfOrdinateRangeForAsymptoteIdentification),  # fractionOfOrdinateRangeForAsymptoteIdentification
+                                             newKnots.ctypes.data_as(c_float_p),  # newKnots
+                                             newCoeffD0.ctypes.data_as(c_float_p),  # newCoeffD0
+                                             newCoeffD1.ctypes.data_as(c_float_p),  # newCoeffD1
+                                             newCoeffD2.ctypes.data_as(c_float_p),  # newCoeffD2
+                                             pointer(newNumberOfKnots),  # newNumberOfKnots
+                                             )
+
+        del c_library
+
+        if status != 0:
+            raise ValueError('Unable to remove the asymptotes of the spline')
+
+        numberOfKnots = newNumberOfKnots.value
+        self._knots = newKnots[:numberOfKnots].copy()
+        self._coeffD0 = newCoeffD0[:numberOfKnots - 1].copy()
+        self._coeffD1 = newCoeffD1[:numberOfKnots - 1].copy()
+        self._coeffD2 = newCoeffD2[:numberOfKnots - 1].copy()
+        self._numberOfPolynomials = numberOfKnots - 1
 
     def removeNegativeSegments(self):
+        """
+        Sets to 0 the parts of the spline where it is negative, splitting the intervals at the roots of the spline
+        """
+        try:
+            c_library = CLibrary(os.path.join(self.module_path, self.binariesFileName))
+        except OSError:
+            raise OSError("Unable to load the system C library")
+
+        c_library.remove_negative_segments.argtypes = [c_float_p,  # knots
+                                                       c_int,  # numberOfKnots
+                                                       c_float_p,  # coeffD0
+                                                       c_float_p,  # coeffD1
+                                                       c_float_p,  # coeffD2
+                                                       c_int,  # stride
+                                                       c_int,  # degree
+                                                       c_int,  # maximumNumberOfKnots
+                                                       c_float_p,  # newKnots
+                                                       c_float_p,  # newCoeffD0
+                                                       c_float_p,  # newCoeffD1
+                                                       c_float_p,  # newCoeffD2
+                                                       c_int_p,  # newNumberOfKnots
+                                                       ]
+
+        c_library.remove_negative_segments.restype = c_int
+
+        knots = np.ascontiguousarray(self._knots, dtype=np.float64)
+        coeffD0 = np.ascontiguousarray(self._coeffD0, dtype=np.float64)
+        coeffD1 = np.ascontiguousarray(self._coeffD1, dtype=np.float64)
+        coeffD2 = np.ascontiguousarray(self._coeffD2, dtype=np.float64)
+
+        # Each interval is split at most at g roots
+        maximumNumberOfKnots = (len(knots) - 1) * (self._g + 1) + 1
+        newNumberOfKnots = c_int()
+
+        while True:
+            newKnots = np.empty(maximumNumberOfKnots)
+            newCoeffD0 = np.empty((maximumNumberOfKnots - 1, self._m))
+            newCoeffD1 = np.empty((maximumNumberOfKnots - 1, self._m))
+            newCoeffD2 = np.empty((maximumNumberOfKnots - 1, self._m))
+            status = c_library.remove_negative_segments(knots.ctypes.data_as(c_float_p),  # knots
+                                                        c_int(len(knots)),  # numberOfKnots
+                                                        coeffD0.ctypes.data_as(c_float_p),  # coeffD0
+                                                        coeffD1.ctypes.data_as(c_float_p),  # coeffD1
+                                                        coeffD2.ctypes.data_as(c_float_p),  # coeffD2
+                                                        c_int(self._m),  # stride
+                                                        c_int(self._g),  # degree
+                                                        c_int(maximumNumberOfKnots),  # maximumNumberOfKnots
+                                                        newKnots.ctypes.data_as(c_float_p),  # newKnots
+                                                        newCoeffD0.ctypes.data_as(c_float_p),  # newCoeffD0
+                                                        newCoeffD1.ctypes.data_as(c_float_p),  # newCoeffD1
+                                                        newCoeffD2.ctypes.data_as(c_float_p),  # newCoeffD2
+                                                        pointer(newNumberOfKnots),  # newNumberOfKnots
+                                                        )
+            # If the knots do not fit, newNumberOfKnots contains their number
+            if status == 0 or newNumberOfKnots.value <= maximumNumberOfKnots:
+                break
+            maximumNumberOfKnots = newNumberOfKnots.value
+
+        del c_library
+
+        if status != 0:
+            raise ValueError('Unable to remove the negative segments of the spline')
 
-        roots = []
-
-        for i in range(self._numberOfPolynomials):
-            roots_coeff = np.array([])
-            for m_val in range(self._g, -1, -1):
-                roots_coeff = np.append(roots_coeff, self._coeffD0[i][m_val])
-            roots += list(np.roots(roots_coeff))
-
-        for root in roots:
-            if not np.iscomplex(root):
-                index = 0
-                root = float(np.real(root))
-                for index_knots in range(len(self._knots)):
-                    if root < self._knots[index_knots]:
-                        break
-                    else:
-                        index += 1
-                if 1 <= index < len(self._knots):
-                    self._knots = np.insert(self._knots, index, root)
-                    self._coeffD0 = np.insert(self._coeffD0, index, self._coeffD0[index - 1], axis=0)
-                    self._coeffD1 = np.insert(self._coeffD1, index, self._coeffD1[index - 1], axis=0)
-                    self._coeffD2 = np.insert(self._coeffD2, index, self._coeffD2[index - 1], axis=0)
-
-        if len(roots) > 0:
-            for index_knot in range(len(self._knots) - 1):
-                midpoint = (self._knots[index_knot] + self._knots[index_knot + 1]) / 2.0
-                if self.evaluate(midpoint, der=0) <= 0:
-                    zeros = np.zeros(self._m)
-                    self._coeffD0[index_knot] = zeros
-                    self._coeffD1[index_knot] = zeros
-                    self._coeffD2[index_knot] = zeros
-
-        self._numberOfPolynomials = len(self._knots)
+        numberOfKnots = newNumberOfKnots.value
+        self._knots = newKnots[:numberOfKnots].copy()
+        self._coeffD0 = newCoeffD0[:numberOfKnots - 1].copy()
+        self._coeffD1 = newCoeffD1[:numberOfKnots - 1].copy()
+        self._coeffD2 = newCoeffD2[:numberOfKnots - 1].copy()
+        self._numberOfPolynomials = numberOfKnots - 1
@@ -0,0 +1,542 @@
+
+/* Point where a spline has a local maximum or minimum */
+struct Extremum {
+
+    /* Position on the x-axis */
+    double abscissa;
+
+    /* Ordinate of the spline */
+    double ordinate;
+
+    /* Specifies whether it is a maximum or a minimum */
+    bool maximum;
+
+    /* Specifies whether it is a well-defined maximum: a maximum whose
+    prominence is a sufficient fraction of the range of the spline */
+    bool wellDefinedMaximum;
+
+};
+
+
+
+/* Normalizations of the ordinates of two splines compared by
+splineDistance */
+enum DistanceNormalization {
+    distanceNotNormalized = 0,          // The splines are compared as they are
+    distanceNormalizedByReference = 1,  // Both splines are divided by the
+                                        // largest absolute ordinate of the
+                                        // first one
+    distanceNormalizedIndividually = 2  // Each spline is divided by its own
+                                        // largest absolute ordinate
+};
+
+
+
+/* Appends to 'roots' the real roots on [knots[0],knots[numberOfKnots-1]] of
+the piecewise polynomial defined as in evaluatePiecewisePolynomial, sorted
+from smallest to largest. Each polynomial is only searched inside its own
+interval, and roots on the knot shared by two polynomials are reported once.
+A knot where the two polynomials have opposite signs is also a root.
+Intervals where the polynomial is equal to 0 have no roots reported */
+void realRootsOfPiecewisePolynomial(const double* knots,
+                                    int numberOfKnots,
+                                    const double* coefficients,
+                                    int stride,
+                                    int degree,
+                                    vector<double>& roots) {
+
+    for (int j=0; j<numberOfKnots-1; ++j) {
+
+        // A change of sign on a knot between two polynomials is a root, even
+        // if rounding puts the roots of both polynomials just outside their
+        // intervals
+        if (j > 0 && (roots.empty() || roots.back() < knots[j])) {
+            double left = hornerAnyDegree(coefficients + (j-1)*stride,
+                                          degree, knots[j]);
+            double right = hornerAnyDegree(coefficients + j*stride,
+                                           degree, knots[j]);
+            if ((left < 0 && right > 0) || (left > 0 && right < 0))
+                roots.push_back(knots[j]);
+        }
+
+        realRootsInInterval(coefficients + j*stride, degree,
+                            knots[j], knots[j+1], roots);
+
+    }
+
+}
+
+
+
+/* Removes the negative parts of the spline whose knots are 'knots' and whose
+polynomials, derivatives and second derivatives have coefficients coeffD0,
+coeffD1 and coeffD2, saved as in evaluatePiecewisePolynomial, the
+polynomials having degree 'degree'. Each interval is split at the roots of
+its polynomial, and the pieces where the spline is not positive get
+polynomials equal to 0. The resulting spline is saved in newKnots,
+newCoeffD0, newCoeffD1 and newCoeffD2, with the same stride, in a single pass
+over the intervals */
+void removeNegativeSegments(const double* knots,
+                            int numberOfKnots,
+                            const double* coeffD0,
+                            const double* coeffD1,
+                            const double* coeffD2,
+                            int stride,
+                            int degree,
+                            vector<double>& newKnots,
+                            vector<double>& newCoeffD0,
+                            vector<double>& newCoeffD1,
+                            vector<double>& newCoeffD2) {
+
+    newKnots.assign(1, knots[0]);
+    newCoeffD0.clear();
+    newCoeffD1.clear();
+    newCoeffD2.clear();
+
+    vector<double> roots;
+    vector<double> zeros(stride, 0);
+
+    for (int j=0; j<numberOfKnots-1; ++j) {
+
+        const double* polynomial = coeffD0 + j*stride;
+
+        // The pieces of the interval end at the roots inside it and at the
+        // right knot
+        roots.clear();
+        realRootsInInterval(polynomial, degree, knots[j], knots[j+1], roots);
+        while (!roots.empty() && !(roots.back() < knots[j+1]))
+            roots.pop_back();
+        roots.push_back(knots[j+1]);
+
+        for (double end : roots) {
+
+            if (!(end > newKnots.back()))
+                continue;
+
+            double middle = 0.5*(newKnots.back()+end);
+            bool positive = hornerAnyDegree(polynomial, degree, middle) > 0;
+
+            const double* source = positive ? polynomial : zeros.data();
+            newCoeffD0.insert(newCoeffD0.end(), source, source+stride);
+            source = positive ? coeffD1 + j*stride : zeros.data();
+            newCoeffD1.insert(newCoeffD1.end(), source, source+stride);
+            source = positive ? coeffD2 + j*stride : zeros.data();
+            newCoeffD2.insert(newCoeffD2.end(), source, source+stride);
+
+            newKnots.push_back(end);
+
+        }
+
+    }
+
+}
+
+
+
+/* Finds the local maxima and minima of the spline whose knots are 'knots' and
+whose polynomials, derivatives and second derivatives have coefficients
+coeffD0, coeffD1 and coeffD2, saved as in removeNegativeSegments, and saves
+them in 'extrema', sorted along the x-axis. They are the roots of the first
+derivative, classified by the sign of the second derivative or, where it is
+0, by the signs of the first derivative around them. A maximum is
+well-defined if its prominence is at least
+fractionOfOrdinateRangeForMaximumIdentification times the range of the
+spline on the y-axis: on both sides, it must be higher by that much than the
+lowest point between it and the nearest higher maximum, or the end of the
+spline, so that small oscillations next to a peak do not hide it. The cost is
+linear in the number of intervals */
+void findExtrema(const double* knots,
+                 int numberOfKnots,
+                 const double* coeffD0,
+                 const double* coeffD1,
+                 const double* coeffD2,
+                 int stride,
+                 int degree,
+                 double fractionOfOrdinateRangeForMaximumIdentification,
+                 vector<Extremum>& extrema) {
+
+    extrema.clear();
+
+    vector<double> stationaryPoints;
+    realRootsOfPiecewisePolynomial(knots, numberOfKnots, coeffD1, stride,
+                                   degree-1, stationaryPoints);
+
+    // Evaluates one of the piecewise polynomials at x. The abscissae are
+    // sorted, so each polynomial is found starting from the previous one
+    int hint = 0;
+    auto evaluate = [&](const double* coefficients, int degreeOfPolynomial,
+                        double x) {
+        int j = findPolynomial(knots, numberOfKnots, x, hint);
+        return hornerAnyDegree(coefficients + j*stride, degreeOfPolynomial, x);
+    };
+
+    int numberOfStationaryPoints = stationaryPoints.size();
+    for (int i=0; i<numberOfStationaryPoints; ++i) {
+
+        double x = stationaryPoints[i];
+        double secondDerivative = evaluate(coeffD2, degree-2, x);
+
+        bool maximum;
+        if (secondDerivative != 0)
+            maximum = secondDerivative < 0;
+        else {
+            // The first derivative has one sign between consecutive
+            // stationary points, so it is evaluated half way to them
+            double before = 0.5*(x + (i > 0 ? stationaryPoints[i-1] : knots[0]));
+            double after = 0.5*(x + (i < numberOfStationaryPoints-1 ?
+                                     stationaryPoints[i+1] :
+                                     knots[numberOfKnots-1]));
+            double slopeBefore = evaluate(coeffD1, degree-1, before);
+            double slopeAfter = evaluate(coeffD1, degree-1, after);
+            if (slopeBefore > 0 && slopeAfter < 0)
+                maximum = true;
+            else if (slopeBefore < 0 && slopeAfter > 0)
+                maximum = false;
+            else
+                continue;
+        }
+
+        extrema.push_back({x, evaluate(coeffD0, degree, x), maximum, false});
+
+    }
+
+    // The range of the spline on the y-axis is delimited by its extrema and
+    // its ends
+    double first = hornerAnyDegree(coeffD0, degree, knots[0]);
+    double last = hornerAnyDegree(coeffD0 + (numberOfKnots-2)*stride, degree,
+                                  knots[numberOfKnots-1]);
+    double highest = max(first, last);
+    double lowest = min(first, last);
+    for (const Extremum& extremum : extrema) {
+        highest = max(highest, extremum.ordinate);
+        lowest = min(lowest, extremum.ordinate);
+    }
+    double minimumHeight =
+        fractionOfOrdinateRangeForMaximumIdentification*(highest-lowest);
+
+    // Finds for each maximum the lowest point between it and the nearest
+    // higher maximum before it, or the first end, going forward with a stack
+    // of maxima of decreasing ordinate, and then after it, going backward. For
+    // each maximum in the stack, 'lowestAfter' is the lowest point between it
+    // and the following one
+    struct StackedMaximum {
+        double ordinate;
+        double lowestAfter;
+    };
+    vector<StackedMaximum> stack;
+
+    auto findBases = [&](int firstIndex, int step, double end,
+                         vector<double>& bases) {
+        stack.clear();
+        double lowestFromEnd = end;
+        for (int i=firstIndex; i>=0 && i<(int)extrema.size(); i+=step) {
+            double ordinate = extrema[i].ordinate;
+            double& lowest = stack.empty() ? lowestFromEnd :
+                                             stack.back().lowestAfter;
+            if (!extrema[i].maximum) {
+                lowest = min(lowest, ordinate);
+                continue;
+            }
+            double lowestAfterHigherMaximum = numeric_limits<double>::max();
+            while (!stack.empty() && stack.back().ordinate <= ordinate) {
+                lowestAfterHigherMaximum =
+                    min(lowestAfterHigherMaximum, stack.back().lowestAfter);
+                stack.pop_back();
+            }
+            double& lowestBefore = stack.empty() ? lowestFromEnd :
+                                                   stack.back().lowestAfter;
+            lowestBefore = min(lowestBefore, lowestAfterHigherMaximum);
+            bases[i] = lowestBefore;
+            stack.push_back({ordinate, numeric_limits<double>::max()});
+        }
+    };
+
+    vector<double> leftBase(extrema.size());
+    vector<double> rightBase(extrema.size());
+    findBases(0, 1, first, leftBase);
+    findBases((int)extrema.size()-1, -1, last, rightBase);
+
+    for (int i=0; i<(int)extrema.size(); ++i)
+        if (extrema[i].maximum)
+            extrema[i].wellDefinedMaximum =
+                extrema[i].ordinate - max(leftBase[i], rightBase[i]) >=
+                minimumHeight;
+
+}
+
+
+
+/* Finds the horizontal asymptotes at the ends of the spline whose knots are
+'knots' and whose polynomials and derivatives have coefficients coeffD0 and
+coeffD1, saved as in removeNegativeSegments: the longest runs of intervals,
+starting from the first and from the last knot, inside which the spline is
+contained in a horizontal area as high as
+fractionOfOrdinateRangeForAsymptoteIdentification times the range of the
+spline on the y-axis. The spline is bounded inside each interval by its
+Bernstein coefficients, so it is not sampled, and the runs are never longer
+than the true ones. Saves in firstPolynomial and lastPolynomial the first and
+the last polynomial outside the asymptotes. If the asymptotes cover the whole
+spline, all of it is kept */
+void findAsymptotes(const double* knots,
+                    int numberOfKnots,
+                    const double* coeffD0,
+                    const double* coeffD1,
+                    int stride,
+                    int degree,
+                    double fractionOfOrdinateRangeForAsymptoteIdentification,
+                    int& firstPolynomial,
+                    int& lastPolynomial) {
+
+    int numberOfPolynomials = numberOfKnots-1;
+    firstPolynomial = 0;
+    lastPolynomial = numberOfPolynomials-1;
+
+    // The range of the spline on the y-axis is delimited by its ends and the
+    // roots of its first derivative
+    vector<double> stationaryPoints;
+    realRootsOfPiecewisePolynomial(knots, numberOfKnots, coeffD1, stride,
+                                   degree-1, stationaryPoints);
+
+    double first = hornerAnyDegree(coeffD0, degree, knots[0]);
+    double last = hornerAnyDegree(coeffD0 + (numberOfPolynomials-1)*stride,
+                                  degree, knots[numberOfKnots-1]);
+    double highest = max(first, last);
+    double lowest = min(first, last);
+    int hint = 0;
+    for (double x : stationaryPoints) {
+        int j = findPolynomial(knots, numberOfKnots, x, hint);
+        double y = hornerAnyDegree(coeffD0 + j*stride, degree, x);
+        highest = max(highest, y);
+        lowest = min(lowest, y);
+    }
+    double maximumHeight =
+        fractionOfOrdinateRangeForAsymptoteIdentification*(highest-lowest);
+
+    // Returns the number of intervals, starting from interval 'first' and
+    // going in direction 'step', inside which the bounds of the spline stay
+    // within maximumHeight
+    auto flatIntervals = [&](int first, int step) {
+        double top = -numeric_limits<double>::max();
+        double bottom = numeric_limits<double>::max();
+        int count = 0;
+        for (int j=first; j>=0 && j<numberOfPolynomials; j+=step) {
+            double lowestInInterval, highestInInterval;
+            bernsteinBounds(coeffD0 + j*stride, degree, knots[j], knots[j+1],
+                            lowestInInterval, highestInInterval);
+            top = max(top, highestInInterval);
+            bottom = min(bottom, lowestInInterval);
+            if (top - bottom > maximumHeight)
+                break;
+            ++count;
+        }
+        return count;
+    };
+
+    int leftAsymptote = flatIntervals(0, 1);
+    int rightAsymptote = flatIntervals(numberOfPolynomials-1, -1);
+
+    if (leftAsymptote + rightAsymptote < numberOfPolynomials) {
+        firstPolynomial = leftAsymptote;
+        lastPolynomial = numberOfPolynomials-1 - rightAsymptote;
+    }
+
+}
+
+
+
+/* Returns the largest absolute value of the spline whose knots are 'knots'
+and whose polynomials and derivatives have coefficients coeffD0 and coeffD1,
+saved as in removeNegativeSegments, on [left,right], found at the ends and at
+the roots of the first derivative */
+double largestAbsoluteOrdinate(const double* knots,
+                               int numberOfKnots,
+                               const double* coeffD0,
+                               const double* coeffD1,
+                               int stride,
+                               int degree,
+                               double left,
+                               double right) {
+
+    vector<double> stationaryPoints;
+    realRootsOfPiecewisePolynomial(knots, numberOfKnots, coeffD1, stride,
+                                   degree-1, stationaryPoints);
+
+    int hint = 0;
+    auto absoluteOrdinate = [&](double x) {
+        int j = findPolynomial(knots, numberOfKnots, x, hint);
+        return fabs(hornerAnyDegree(coeffD0 + j*stride, degree, x));
+    };
+
+    double largest = max(absoluteOrdinate(left), absoluteOrdinate(right));
+    for (double x : stationaryPoints)
+        if (x > left && x < right)
+            largest = max(largest, absoluteOrdinate(x));
+
+    return largest;
+
+}
+
+
+
+/* Returns the integral on [left,right] of the square of the difference
+between scaleA times the piecewise polynomial with knots knotsA and
+coefficients coefficientsA, and scaleB times the one with knots knotsB and
+coefficientsB, both saved as in evaluatePiecewisePolynomial. The knots of the
+two are merged, and on each interval between them the difference is a single
+polynomial, which is shifted to the left end of the interval and squared, so
+that the integral is exact up to rounding */
+double integralOfSquaredDifference(const double* knotsA,
+                                   int numberOfKnotsA,
+                                   const double* coefficientsA,
+                                   int strideA,
+                                   int degreeA,
+                                   double scaleA,
+                                   const double* knotsB,
+                                   int numberOfKnotsB,
+                                   const double* coefficientsB,
+                                   int strideB,
+                                   int degreeB,
+                                   double scaleB,
+                                   double left,
+                                   double right) {
+
+    int degree = max(degreeA, degreeB);
+    if (degree < 0)
+        return 0;
+
+    vector<double> difference(degree+1);
+    vector<double> local(degree+1);
+    vector<double> square(2*degree+1);
+
+    int hintA = 0;
+    int hintB = 0;
+    int nextA = upper_bound(knotsA, knotsA+numberOfKnotsA, left) - knotsA;
+    int nextB = upper_bound(knotsB, knotsB+numberOfKnotsB, left) - knotsB;
+
+    double integral = 0;
+    double start = left;
+
+    while (start < right) {
+
+        // The interval ends at the first knot of either spline after its start
+        double end = right;
+        if (nextA < numberOfKnotsA)
+            end = min(end, knotsA[nextA]);
+        if (nextB < numberOfKnotsB)
+            end = min(end, knotsB[nextB]);
+
+        double middle = 0.5*(start+end);
+        int j = findPolynomial(knotsA, numberOfKnotsA, middle, hintA);
+        int k = findPolynomial(knotsB, numberOfKnotsB, middle, hintB);
+
+        // Difference of the two polynomials, in powers of (x - start)
+        fill(difference.begin(), difference.end(), 0.);
+        fill(local.begin(), local.end(), 0.);
+        copy(coefficientsA + j*strideA,
+             coefficientsA + j*strideA + degreeA+1, local.begin());
+        shiftPolynomial(local.data(), degree, start);
+        for (int a=0; a<=degree; ++a)
+            difference[a] = scaleA*local[a];
+        fill(local.begin(), local.end(), 0.);
+        copy(coefficientsB + k*strideB,
+             coefficientsB + k*strideB + degreeB+1, local.begin());
+        shiftPolynomial(local.data(), degree, start);
+        for (int a=0; a<=degree; ++a)
+            difference[a] -= scaleB*local[a];
+
+        // Integral of the square on [0,end-start]
+        fill(square.begin(), square.end(), 0.);
+        for (int a=0; a<=degree; ++a)
+            for (int b=0; b<=degree; ++b)
+                square[a+b] += difference[a]*difference[b];
+        double width = end-start;
+        double power = width;
+        for (int a=0; a<=2*degree; ++a) {
+            integral += square[a]*power/(double)(a+1);
+            power *= width;
+        }
+
+        while (nextA < numberOfKnotsA && !(knotsA[nextA] > end))
+            ++nextA;
+        while (nextB < numberOfKnotsB && !(knotsB[nextB] > end))
+            ++nextB;
+        start = end;
+
+    }
+
+    return integral;
+
+}
+
+
+
+/* Calculates the L2 distances between the spline A and the spline B, and
+between their first derivatives, on the intersection of their domains. Each
+spline is given by its knots and by the coefficients of its polynomials and
+derivatives, saved as in removeNegativeSegments, and the two can have
+different knots and degrees. The ordinates are normalized according to
+'normalization', and the derivatives are divided by the same factors as the
+splines. If divideByDomainLength is true, the integrals are divided by the
+length of the intersection, so that the distances are root mean squares. The
+integrals are exact, and the cost is linear in the number of knots. Returns
+false, without calculating the distances, if the domains do not intersect or
+if a spline to be normalized is 0 on the intersection */
+bool splineDistance(const double* knotsA,
+                    int numberOfKnotsA,
+                    const double* coeffD0A,
+                    const double* coeffD1A,
+                    int strideA,
+                    int degreeA,
+                    const double* knotsB,
+                    int numberOfKnotsB,
+                    const double* coeffD0B,
+                    const double* coeffD1B,
+                    int strideB,
+                    int degreeB,
+                    DistanceNormalization normalization,
+                    bool divideByDomainLength,
+                    double& distanceD0,
+                    double& distanceD1) {
+
+    double left = max(knotsA[0], knotsB[0]);
+    double right = min(knotsA[numberOfKnotsA-1], knotsB[numberOfKnotsB-1]);
+    if (!(right > left))
+        return false;
+
+    double scaleA = 1;
+    double scaleB = 1;
+    if (normalization != distanceNotNormalized) {
+        double largestA = largestAbsoluteOrdinate(knotsA, numberOfKnotsA,
+                                                  coeffD0A, coeffD1A, strideA,
+                                                  degreeA, left, right);
+        double largestB = normalization == distanceNormalizedByReference ?
+            largestA :
+            largestAbsoluteOrdinate(knotsB, numberOfKnotsB, coeffD0B, coeffD1B,
+                                    strideB, degreeB, left, right);
+        if (!(largestA > 0) || !(largestB > 0))
+            return false;
+        scaleA = 1./largestA;
+        scaleB = 1./largestB;
+    }
+
+    double integralD0 = integralOfSquaredDifference(
+        knotsA, numberOfKnotsA, coeffD0A, strideA, degreeA, scaleA,
+        knotsB, numberOfKnotsB, coeffD0B, strideB, degreeB, scaleB,
+        left, right);
+    double integralD1 = integralOfSquaredDifference(
+        knotsA, numberOfKnotsA, coeffD1A, strideA, degreeA-1, scaleA,
+        knotsB, numberOfKnotsB, coeffD1B, strideB, degreeB-1, scaleB,
+        left, right);
+
+    if (divideByDomainLength) {
+        integralD0 /= right-left;
+        integralD1 /= right-left;
+    }
+
+    // Rounding can make a vanishing integral slightly negative
+    distanceD0 = sqrt(max(integralD0, 0.));
+    distanceD1 = sqrt(max(integralD1, 0.));
+
+    return true;
+
+}
@@ -0,0 +1,309 @@
+
+/* Number of points whose polynomials are found before evaluating them */
+const int evaluationBlockSize = 256;
+
+/* Function evaluating, for i = 0, ..., n-1, the polynomial of degree 'degree'
+whose coefficients, from the constant term up, start from position
+index[i]*stride of 'coefficients', at position x[i], and saving the result in
+y[i] */
+typedef void (*EvaluationKernel)(const double* coefficients,
+                                 int stride,
+                                 int degree,
+                                 const int* index,
+                                 const double* x,
+                                 int n,
+                                 double* y);
+
+
+
+/* Returns the index of the polynomial containing position x on the x-axis:
+the last polynomial whose left knot is smaller than x, or the first
+polynomial. The search starts from polynomial 'hint', which is then set to the
+result, so that sorted abscissae are found in constant time */
+int findPolynomial(const double* knots, int numberOfKnots, double x, int& hint) {
+
+    int last = max(numberOfKnots-2,0);
+    int indexOfPolynomial = max(0, min(hint, last));
+
+    for (int step=0; step<4; ++step) {
+        if (indexOfPolynomial < last && x > knots[indexOfPolynomial+1])
+            ++indexOfPolynomial;
+        else if (indexOfPolynomial > 0 && !(x > knots[indexOfPolynomial]))
+            --indexOfPolynomial;
+        else {
+            hint = indexOfPolynomial;
+            return indexOfPolynomial;
+        }
+    }
+
+    indexOfPolynomial = lower_bound(knots, knots+last+1, x) - knots - 1;
+    hint = max(indexOfPolynomial,0);
+    return hint;
+
+}
+
+
+
+/* Evaluation kernel processing one point at a time */
+void evaluatePolynomialsScalar(const double* coefficients,
+                               int stride,
+                               int degree,
+                               const int* index,
+                               const double* x,
+                               int n,
+                               double* y) {
+
+    for (int i=0; i<n; ++i) {
+        const double* polynomial = coefficients + index[i]*stride;
+        double value = 0;
+        if (degree >= 0) {
+            value = polynomial[degree];
+            for (int a=degree-1; a>=0; --a)
+                value = value*x[i] + polynomial[a];
+        }
+        y[i] = value;
+    }
+
+}
+
+
+
+#if defined(__x86_64__) && defined(__GNUC__)
+
+/* Evaluation kernel processing four points at a time with AVX2. Products and
+sums are not fused, so the results are identical to those of the scalar
+kernel */
+__attribute__((target("avx2")))
+void evaluatePolynomialsAVX2(const double* coefficients,
+                             int stride,
+                             int degree,
+                             const int* index,
+                             const double* x,
+                             int n,
+                             double* y) {
+
+    if (degree < 0) {
+        evaluatePolynomialsScalar(coefficients, stride, degree, index, x, n, y);
+        return;
+    }
+
+    __m128i strides = _mm_set1_epi32(stride);
+
+    // The masked gathers, with all the lanes enabled and a zero source, leave
+    // no lane of the result undefined
+    const __m256d zero = _mm256_setzero_pd();
+    const __m256d allLanes = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+
+    int i = 0;
+    for (; i+4<=n; i+=4) {
+        __m128i first = _mm_mullo_epi32(
+            _mm_loadu_si128((const __m128i*)(index+i)), strides);
+        __m256d abscissae = _mm256_loadu_pd(x+i);
+        __m256d value = _mm256_mask_i32gather_pd(
+            zero, coefficients, _mm_add_epi32(first, _mm_set1_epi32(degree)),
+            allLanes, 8);
+        for (int a=degree-1; a>=0; --a)
+            value = _mm256_add_pd(
+                _mm256_mul_pd(value, abscissae),
+                _mm256_mask_i32gather_pd(
+                    zero, coefficients, _mm_add_epi32(first, _mm_set1_epi32(a)),
+                    allLanes, 8));
+        _mm256_storeu_pd(y+i, value);
+    }
+
+    evaluatePolynomialsScalar(coefficients, stride, degree,
+                              index+i, x+i, n-i, y+i);
+
+}
+
+
+
+/* Evaluation kernel processing eight points at a time with AVX-512. The
+compiler is not allowed to fuse products and sums, which AVX-512 would
+otherwise turn into fused multiply-adds, so the results are identical to those
+of the scalar kernel */
+__attribute__((target("avx512f"), optimize("fp-contract=off")))
+void evaluatePolynomialsAVX512(const double* coefficients,
+                               int stride,
+                               int degree,
+                               const int* index,
+                               const double* x,
+                               int n,
+                               double* y) {
+
+    if (degree < 0) {
+        evaluatePolynomialsScalar(coefficients, stride, degree, index, x, n, y);
+        return;
+    }
+
+    __m256i strides = _mm256_set1_epi32(stride);
+
+    // As in evaluatePolynomialsAVX2, the gathers are masked with all the lanes
+    // enabled and a zero source
+    const __m512d zero = _mm512_setzero_pd();
+    const __mmask8 allLanes = 0xFF;
+
+    int i = 0;
+    for (; i+8<=n; i+=8) {
+        __m256i first = _mm256_mullo_epi32(
+            _mm256_loadu_si256((const __m256i*)(index+i)), strides);
+        __m512d abscissae = _mm512_loadu_pd(x+i);
+        __m512d value = _mm512_mask_i32gather_pd(
+            zero, allLanes,
+            _mm256_add_epi32(first, _mm256_set1_epi32(degree)),
+            coefficients, 8);
+        for (int a=degree-1; a>=0; --a)
+            value = _mm512_add_pd(
+                _mm512_mul_pd(value, abscissae),
+                _mm512_mask_i32gather_pd(
+                    zero, allLanes,
+                    _mm256_add_epi32(first, _mm256_set1_epi32(a)),
+                    coefficients, 8));
+        _mm512_storeu_pd(y+i, value);
+    }
+
+    evaluatePolynomialsScalar(coefficients, stride, degree,
+                              index+i, x+i, n-i, y+i);
+
+}
+
+#endif
+
+
+
+/* Returns the fastest evaluation kernel supported by the processor. The
+choice is made at the first call */
+EvaluationKernel evaluationKernel() {
+
+    static const EvaluationKernel kernel = [] {
+#if defined(__x86_64__) && defined(__GNUC__)
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f"))
+            return &evaluatePolynomialsAVX512;
+        if (__builtin_cpu_supports("avx2"))
+            return &evaluatePolynomialsAVX2;
+#endif
+        return &evaluatePolynomialsScalar;
+    }();
+
+    return kernel;
+
+}
+
+
+
+/* Evaluates at the n abscissae x the piecewise polynomial defined on
+numberOfKnots knots, whose polynomials have degree 'degree' and coefficients
+saved one polynomial after the other, 'stride' for each polynomial, and saves
+the results in y. The abscissae do not need to be sorted, but sorted
+abscissae are found faster */
+void evaluatePiecewisePolynomial(const double* knots,
+                                 int numberOfKnots,
+                                 const double* coefficients,
+                                 int stride,
+                                 int degree,
+                                 const double* x,
+                                 int n,
+                                 double* y) {
+
+    EvaluationKernel kernel = evaluationKernel();
+
+    int index[evaluationBlockSize];
+    int hint = 0;
+
+    for (int first=0; first<n; first+=evaluationBlockSize) {
+        int size = min(evaluationBlockSize, n-first);
+        for (int i=0; i<size; ++i)
+            index[i] = findPolynomial(knots, numberOfKnots, x[first+i], hint);
+        kernel(coefficients, stride, degree, index, x+first, size, y+first);
+    }
+
+}
+
+
+
+/* Calculates the coefficients, from the constant term up, of the polynomial
+p(x) of degree 'degree' expressed in powers of (x - origin), overwriting
+those of p(x) in powers of x */
+void shiftPolynomial(double* coefficients, int degree, double origin) {
+
+    for (int k=0; k<degree; ++k)
+        for (int a=degree-1; a>=k; --a)
+            coefficients[a] += origin*coefficients[a+1];
+
+}
+
+
+
+/* Evaluates the piecewise polynomial defined as in
+evaluatePiecewisePolynomial, and its first and second derivatives, at the n
+equally spaced abscissae start + i*step, i = 0, ..., n-1, saving the results in
+d0, d1 and d2. Any of them can be null, if not needed. The intervals are
+walked in order, forward or backward according to the sign of step, and each
+polynomial is shifted to its left knot once, so that the points inside it
+only need a short Horner evaluation in the distance from the knot, which also
+gives the derivatives */
+void samplePiecewisePolynomial(const double* knots,
+                               int numberOfKnots,
+                               const double* coefficients,
+                               int stride,
+                               int degree,
+                               double start,
+                               double step,
+                               int n,
+                               double* d0,
+                               double* d1,
+                               double* d2) {
+
+    int last = max(numberOfKnots-2,0);
+
+    // The shifted polynomial is kept on the stack for the degrees with a
+    // specialized Horner kernel, the only ones used by the splines
+    double localOnStack[maximumKernelDegree+1];
+    vector<double> localOnHeap;
+    if (degree > maximumKernelDegree)
+        localOnHeap.resize(degree+1);
+    double* local = degree > maximumKernelDegree ? localOnHeap.data() :
+                                                   localOnStack;
+
+    int indexOfPolynomial = -1;
+
+    for (int i=0; i<n; ++i) {
+
+        double x = start + (double)i*step;
+
+        // Finds the polynomial containing x, as findPolynomial does, and
+        // shifts it when it changes
+        int previousPolynomial = indexOfPolynomial;
+        if (indexOfPolynomial < 0)
+            indexOfPolynomial =
+                max((int)(lower_bound(knots, knots+last+1, x) - knots) - 1, 0);
+        while (indexOfPolynomial < last && x > knots[indexOfPolynomial+1])
+            ++indexOfPolynomial;
+        while (indexOfPolynomial > 0 && !(x > knots[indexOfPolynomial]))
+            --indexOfPolynomial;
+        if (indexOfPolynomial != previousPolynomial) {
+            copy(coefficients + indexOfPolynomial*stride,
+                 coefficients + indexOfPolynomial*stride + degree+1,
+                 local);
+            shiftPolynomial(local, degree, knots[indexOfPolynomial]);
+        }
+
+        // Horner's method on the polynomial and on its derivatives at once
+        double t = x - knots[indexOfPolynomial];
+        double value = local[degree];
+        double firstDerivative = 0;
+        double secondDerivative = 0;
+        for (int a=degree-1; a>=0; --a) {
+            secondDerivative = secondDerivative*t + firstDerivative;
+            firstDerivative = firstDerivative*t + value;
+            value = value*t + local[a];
+        }
+
+        if (d0) d0[i] = value;
+        if (d1) d1[i] = firstDerivative;
+        if (d2) d2[i] = 2*secondDerivative;
+
+    }
+
+}
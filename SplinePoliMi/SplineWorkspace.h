@@ -0,0 +1,215 @@
+
+/* Temporaries of the calculation of a spline. The matrices and vectors keep
+their memory from one fit to the next, so once the workspace has grown to the
+size required by the data, calculating a spline of similar size does not
+allocate memory for them. Each thread uses its own workspace, obtained from
+threadWorkspace() */
+class SplineWorkspace {
+
+public:
+
+    /* Real knots of the spline, copied to the spline once they are chosen */
+    vector<double> knots;
+
+    /* Knots of the spline, including non-real ones at the end points */
+    vector<double> knotsForCalculations;
+
+    /* Basis functions of the spline */
+    BasisFunctions basisFunctions;
+
+    /* Matrix of the values of the basis functions at the abscissae */
+    DesignMatrix Fi;
+
+    /* Matrix of the first derivatives of the basis functions at the abscissae
+    */
+    DesignMatrix FiD1;
+
+    /* Product of the transpose of the Fi matrix and the Fi matrix */
+    BandMatrix FiTFi;
+
+    /* Matrix of the integrals of the products of the second derivatives of
+    the basis functions */
+    BandMatrix R;
+
+    /* Product of the transpose of the Fi matrix and the ordinates */
+    vector<double> FiTy;
+
+    /* Demmler-Reinsch basis of FiTFi and R */
+    DemmlerReinsch demmlerReinsch;
+
+    /* Matrices used while calculating GCV1 */
+    GCV1Workspace GCV1;
+
+    /* Best value of GCV1 found */
+    GCV1Minimum minimum;
+
+    /* Number of fits calculated with the workspace */
+    long numberOfFits = 0;
+
+    /* Number of fits which allocated memory on the heap for their temporaries
+    */
+    long numberOfFitsWithAllocations = 0;
+
+    /* Number of heap allocations made by the fits for their temporaries,
+    counted as the members of the workspace whose reserved memory grew during
+    a fit */
+    long numberOfAllocations = 0;
+
+    ////////////////////////////////////////////////////////////////////////////
+
+    /* Removes the memory of the workspace from workspaceStatistics */
+    ~SplineWorkspace();
+
+    /* Memory reserved by the matrices and vectors of the workspace, in bytes
+    */
+    size_t reservedBytes() const;
+
+    /* Marks the beginning of the part of a fit using the temporaries. The
+    members whose reserved memory grows from here to endFit() are counted as
+    allocations, including the workspaces of the threads sharing the values of
+    lambda */
+    void beginFit();
+
+    /* Marks the end of the part of a fit using the temporaries, and updates
+    the counters of the workspace and workspaceStatistics */
+    void endFit();
+
+////////////////////////////////////////////////////////////////////////////////
+
+private:
+
+    /* Number of members of the workspace whose reserved memory is tracked */
+    static const int numberOfMembers = 11;
+
+    /* Memory reserved by each member when the current fit began, in bytes */
+    size_t reservedBytesAtBeginning[numberOfMembers] = {};
+
+    /* Memory of the workspace included in workspaceStatistics */
+    size_t reservedBytesInStatistics = 0;
+
+    ////////////////////////////////////////////////////////////////////////////
+
+    /* Saves in 'bytes' the memory reserved by each member, in bytes */
+    void reservedBytesOfMembers(size_t* bytes) const;
+
+};
+
+
+
+/* Counters of all the workspaces of the process, which can be read while fits
+are running */
+struct WorkspaceStatistics {
+
+    /* Number of fits calculated */
+    atomic<long> numberOfFits{0};
+
+    /* Number of fits which allocated memory on the heap for their temporaries
+    */
+    atomic<long> numberOfFitsWithAllocations{0};
+
+    /* Number of heap allocations made by the fits for their temporaries,
+    counted as in SplineWorkspace */
+    atomic<long> numberOfAllocations{0};
+
+    /* Memory currently reserved by the workspaces, in bytes */
+    atomic<long> reservedBytes{0};
+
+};
+
+WorkspaceStatistics workspaceStatistics;
+
+
+
+/* Returns the workspace of the calling thread, which is reused by all the
+fits calculated by the thread */
+SplineWorkspace& threadWorkspace() {
+
+    thread_local SplineWorkspace workspace;
+
+    return workspace;
+
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+
+
+SplineWorkspace::~SplineWorkspace() {
+
+    workspaceStatistics.reservedBytes -= (long)reservedBytesInStatistics;
+
+}
+
+
+
+size_t SplineWorkspace::reservedBytes() const {
+
+    size_t bytes[numberOfMembers];
+    reservedBytesOfMembers(bytes);
+
+    return accumulate(bytes, bytes+numberOfMembers, (size_t)0);
+
+}
+
+
+
+void SplineWorkspace::beginFit() {
+
+    reservedBytesOfMembers(reservedBytesAtBeginning);
+
+}
+
+
+
+void SplineWorkspace::endFit() {
+
+    // The vectors only grow, so a member whose memory grew has allocated at
+    // least once. Members which allocate more than once in a fit are counted
+    // once
+    size_t bytesOfMembers[numberOfMembers];
+    reservedBytesOfMembers(bytesOfMembers);
+    long allocations = 0;
+    for (int i=0; i<numberOfMembers; ++i)
+        if (bytesOfMembers[i] > reservedBytesAtBeginning[i])
+            ++allocations;
+
+    ++numberOfFits;
+    ++workspaceStatistics.numberOfFits;
+
+    if (allocations > 0) {
+        ++numberOfFitsWithAllocations;
+        ++workspaceStatistics.numberOfFitsWithAllocations;
+        numberOfAllocations += allocations;
+        workspaceStatistics.numberOfAllocations += allocations;
+    }
+
+    size_t bytes = accumulate(bytesOfMembers, bytesOfMembers+numberOfMembers,
+                              (size_t)0);
+
+    workspaceStatistics.reservedBytes +=
+        (long)bytes - (long)reservedBytesInStatistics;
+    reservedBytesInStatistics = bytes;
+
+}
+
+
+
+void SplineWorkspace::reservedBytesOfMembers(size_t* bytes) const {
+
+    bytes[0] = knots.capacity()*sizeof(double);
+    bytes[1] = knotsForCalculations.capacity()*sizeof(double);
+    bytes[2] = basisFunctions.reservedBytes();
+    bytes[3] = Fi.reservedBytes();
+    bytes[4] = FiD1.reservedBytes();
+    bytes[5] = FiTFi.reservedBytes();
+    bytes[6] = R.reservedBytes();
+    bytes[7] = FiTy.capacity()*sizeof(double);
+    bytes[8] = demmlerReinsch.reservedBytes();
+    bytes[9] = GCV1.reservedBytes();
+    bytes[10] = minimum.coefficients.capacity()*sizeof(double);
+
+}
@@ -0,0 +1,259 @@
+
+class ThreadPool {
+
+public:
+
+    /* Starts numberOfThreads-1 worker threads. The thread calling run() works
+    together with them */
+    explicit ThreadPool(int numberOfThreads);
+
+    /* Stops and joins the worker threads */
+    ~ThreadPool();
+
+    /* Number of threads of the pool, including the one calling run() */
+    int numberOfThreads() const;
+
+    /* Calls task(i) for i = 0, ..., numberOfTasks-1, sharing the calls among
+    the threads of the pool, and returns when all of them are completed. If a
+    task throws, the tasks not yet started are skipped and run() rethrows the
+    first exception. Once the pool has run a first time, run() allocates
+    nothing itself */
+    template <class Task>
+    void run(int numberOfTasks, const Task& task);
+
+////////////////////////////////////////////////////////////////////////////////
+
+private:
+
+    /* Tasks submitted by a single call of run(). Worker threads keep a
+    reference to it, so that a thread waking up late never touches the tasks of
+    the following call */
+    struct Job {
+        void (*call)(const void* task, int i);
+        const void* task;
+        int numberOfTasks;
+        atomic<int> nextTask;
+        atomic<int> completedTasks;
+        /* Set by the first task which throws, which then saves its exception
+        in error */
+        atomic<bool> failed;
+        exception_ptr error;
+    };
+
+    vector<thread> workers;
+
+    /* Protects job, generation and stop */
+    mutex jobMutex;
+
+    /* Signals the workers that a new job is available, or that they must stop
+    */
+    condition_variable jobAvailable;
+
+    /* Signals run() that all the tasks of the job are completed */
+    condition_variable jobCompleted;
+
+    /* Serializes concurrent calls of run() */
+    mutex runMutex;
+
+    shared_ptr<Job> job;
+
+    /* Job of the previous call of run(), reused by the next one when no worker
+    refers to it any more */
+    shared_ptr<Job> spareJob;
+
+    /* Incremented for each new job */
+    long generation = 0;
+
+    bool stop = false;
+
+    ////////////////////////////////////////////////////////////////////////////
+
+    /* Calls call(task, i) for the tasks of a new job, as run() */
+    void runJob(int numberOfTasks,
+                void (*call)(const void* task, int i),
+                const void* task);
+
+    /* Main loop of the worker threads */
+    void work();
+
+    /* Executes tasks of the job until none is left. An exception thrown by a
+    task is saved in the job, so that the task still counts as completed */
+    void execute(Job& currentJob);
+
+};
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+
+
+ThreadPool::ThreadPool(int numberOfThreads) {
+
+    for (int t=1; t<numberOfThreads; ++t)
+        workers.emplace_back(&ThreadPool::work, this);
+
+}
+
+
+
+ThreadPool::~ThreadPool() {
+
+    {
+        lock_guard<mutex> lock(jobMutex);
+        stop = true;
+    }
+    jobAvailable.notify_all();
+
+    for (auto& worker : workers)
+        worker.join();
+
+}
+
+
+
+int ThreadPool::numberOfThreads() const {
+
+    return workers.size() + 1;
+
+}
+
+
+
+template <class Task>
+void ThreadPool::run(int numberOfTasks, const Task& task) {
+
+    // The task is called through a plain function pointer, since wrapping it
+    // in a std::function could allocate memory at each call
+    runJob(numberOfTasks,
+           [](const void* taskToCall, int i) {
+               (*static_cast<const Task*>(taskToCall))(i);
+           },
+           &task);
+
+}
+
+
+
+void ThreadPool::runJob(int numberOfTasks,
+                        void (*call)(const void* task, int i),
+                        const void* task) {
+
+    if (numberOfTasks <= 0)
+        return;
+
+    lock_guard<mutex> runLock(runMutex);
+
+    // The job of the previous call can be reused if no worker woken late still
+    // refers to it. Nobody can obtain a new reference to it, since it is not
+    // the current job any more
+    shared_ptr<Job> newJob;
+    if (spareJob.use_count() == 1) {
+        atomic_thread_fence(memory_order_acquire);
+        newJob = spareJob;
+    }
+    else
+        newJob = make_shared<Job>();
+    newJob->call = call;
+    newJob->task = task;
+    newJob->numberOfTasks = numberOfTasks;
+    newJob->nextTask = 0;
+    newJob->completedTasks = 0;
+    newJob->failed = false;
+
+    {
+        lock_guard<mutex> lock(jobMutex);
+        job = newJob;
+        ++generation;
+    }
+    jobAvailable.notify_all();
+
+    execute(*newJob);
+
+    unique_lock<mutex> lock(jobMutex);
+    jobCompleted.wait(lock, [&] {
+        return newJob->completedTasks == numberOfTasks;
+    });
+    job.reset();
+    spareJob = newJob;
+
+    if (newJob->error) {
+        exception_ptr error = newJob->error;
+        newJob->error = nullptr;
+        rethrow_exception(error);
+    }
+
+}
+
+
+
+void ThreadPool::work() {
+
+    long lastGeneration = 0;
+
+    while (true) {
+
+        shared_ptr<Job> currentJob;
+        {
+            unique_lock<mutex> lock(jobMutex);
+            jobAvailable.wait(lock, [&] {
+                return stop || generation != lastGeneration;
+            });
+            if (stop)
+                return;
+            lastGeneration = generation;
+            currentJob = job;
+        }
+
+        if (currentJob)
+            execute(*currentJob);
+
+    }
+
+}
+
+
+
+void ThreadPool::execute(Job& currentJob) {
+
+    int numberOfTasks = currentJob.numberOfTasks;
+    int i = currentJob.nextTask++;
+    while (i < numberOfTasks) {
+        if (!currentJob.failed) {
+            try {
+                currentJob.call(currentJob.task, i);
+            }
+            catch (...) {
+                // error is read by run() only after this task is counted as
+                // completed
+                if (!currentJob.failed.exchange(true))
+                    currentJob.error = current_exception();
+            }
+        }
+        if (++currentJob.completedTasks == numberOfTasks) {
+            lock_guard<mutex> lock(jobMutex);
+            jobCompleted.notify_all();
+        }
+        i = currentJob.nextTask++;
+    }
+
+}
+
+
+
+/* Returns 'pool', first replacing it with a new pool of numberOfThreads
+threads if it is null or has a different number of threads. Keeping the pool
+avoids starting threads at each call, and lets the threads keep their
+workspaces */
+ThreadPool& reusableThreadPool(unique_ptr<ThreadPool>& pool,
+                               int numberOfThreads) {
+
+    numberOfThreads = max(1, numberOfThreads);
+    if (!pool || pool->numberOfThreads() != numberOfThreads)
+        pool.reset(new ThreadPool(numberOfThreads));
+
+    return *pool;
+
+}
@@ -19,18 +19,29 @@ auto printV_inLine = [](const auto& vector) {
 };
 
 /* Print settings */
-void printSettings(){
-    cout << "m:  " << m << endl;
-    cout << "g:  " << g << endl;
-    cout << "lambdaSearchInterval:  " << lambdaSearchInterval << endl;
-    cout << "numberOfStepsLambda:  " << numberOfStepsLambda << endl;
-    cout << "numberOfRatiolkForAICcUse:  " << numberOfRatiolkForAICcUse << endl;
-    cout << "fractionOfOrdinateRangeForAsymptoteIdentification:  " << fractionOfOrdinateRangeForAsymptoteIdentification << endl;
-    cout << "fractionOfOrdinateRangeForMaximumIdentification:  " << fractionOfOrdinateRangeForMaximumIdentification << endl;
+void printSettings(const Settings& settings){
+    cout << "m:  " << settings.m << endl;
+    cout << "g:  " << settings.g << endl;
+    cout << "lambdaSearchInterval:  " << settings.lambdaSearchInterval << endl;
+    cout << "numberOfStepsLambda:  " << settings.numberOfStepsLambda << endl;
+    cout << "numberOfThreadsLambda:  " << settings.numberOfThreadsLambda << endl;
+    cout << "numberOfAbscissaeSeparatingConsecutiveKnots:  ";
+    printV_inLine(settings.numberOfAbscissaeSeparatingConsecutiveKnots);
+    cout << "numberOfThreadsCandidates:  " << settings.numberOfThreadsCandidates << endl;
+    cout << "numberOfRatiolkForAICcUse:  " << settings.numberOfRatiolkForAICcUse << endl;
+    cout << "lambdaOptimizer:  " << lambdaOptimizerNames[settings.lambdaOptimizer] << endl;
+    cout << "lambdaTolerance:  " << settings.lambdaTolerance << endl;
+    cout << "maximumLambdaEvaluations:  " << settings.maximumLambdaEvaluations << endl;
+    cout << "numberOfStepsLambdaBracket:  " << settings.numberOfStepsLambdaBracket << endl;
+    cout << "solver:  " << solverNames[settings.solver] << endl;
+    cout << "penalty:  " << penaltyNames[settings.penalty] << endl;
+    cout << "differenceOrder:  " << settings.differenceOrder << endl;
+    cout << "fractionOfOrdinateRangeForAsymptoteIdentification:  " << settings.fractionOfOrdinateRangeForAsymptoteIdentification << endl;
+    cout << "fractionOfOrdinateRangeForMaximumIdentification:  " << settings.fractionOfOrdinateRangeForMaximumIdentification << endl;
 //    cout << "possibleNegativeOrdinates:  " << possibleNegativeOrdinates << endl;
 //    cout << "removeAsymptotes:  " << removeAsymptotes << endl;
-    cout << "graphPoints:  " << graphPoints << endl;
-    cout << "criterion:  " << criterion << endl;
+    cout << "graphPoints:  " << settings.graphPoints << endl;
+    cout << "criterion:  " << settings.criterion << endl;
 
     // NB: pascalsTriangle is not printed
 
@@ -196,3 +207,182 @@ void invertWithGaussJordan(vector<vector<double>>& A,
 
 }
 
+
+
+/* Calculates the eigenvalues and the eigenvectors of the symmetric matrix
+made of the first K rows and columns of A, using the Householder reduction to
+tridiagonal form followed by the QL algorithm with implicit shifts. That part
+of A is replaced by the matrix whose columns are the eigenvectors. 'work'
+receives the subdiagonal of the tridiagonal form */
+void calculateEigenvalues(vector<vector<double>>& A,
+                          int K,
+                          vector<double>& eigenvalues,
+                          vector<double>& work) {
+
+    vector<vector<double>>& V = A;
+    vector<double>& d = eigenvalues;
+    vector<double>& e = work;
+    e.assign(K,0);
+
+    d.assign(K,0);
+    if (K == 0) return;
+
+    // Householder reduction to tridiagonal form. At the end d contains the
+    // main diagonal, e the subdiagonal and V the orthogonal transformation
+    for (int j=0; j<K; ++j)
+        d[j] = V[K-1][j];
+
+    for (int i=K-1; i>0; --i) {
+
+        double scale = 0;
+        double h = 0;
+        for (int k=0; k<i; ++k)
+            scale += fabs(d[k]);
+
+        if (scale == 0) {
+            e[i] = d[i-1];
+            for (int j=0; j<i; ++j) {
+                d[j] = V[i-1][j];
+                V[i][j] = 0;
+                V[j][i] = 0;
+            }
+        }
+        else {
+            for (int k=0; k<i; ++k) {
+                d[k] /= scale;
+                h += d[k] * d[k];
+            }
+            double f = d[i-1];
+            double gamma = f > 0 ? -sqrt(h) : sqrt(h);
+            e[i] = scale * gamma;
+            h -= f * gamma;
+            d[i-1] = f - gamma;
+            for (int j=0; j<i; ++j)
+                e[j] = 0;
+
+            for (int j=0; j<i; ++j) {
+                f = d[j];
+                V[j][i] = f;
+                gamma = e[j] + V[j][j] * f;
+                for (int k=j+1; k<i; ++k) {
+                    gamma += V[k][j] * d[k];
+                    e[k] += V[k][j] * f;
+                }
+                e[j] = gamma;
+            }
+
+            f = 0;
+            for (int j=0; j<i; ++j) {
+                e[j] /= h;
+                f += e[j] * d[j];
+            }
+            double hh = f / (h + h);
+            for (int j=0; j<i; ++j)
+                e[j] -= hh * d[j];
+            for (int j=0; j<i; ++j) {
+                f = d[j];
+                gamma = e[j];
+                for (int k=j; k<i; ++k)
+                    V[k][j] -= (f * e[k] + gamma * d[k]);
+                d[j] = V[i-1][j];
+                V[i][j] = 0;
+            }
+        }
+
+        d[i] = h;
+
+    }
+
+    // Accumulates the transformations
+    for (int i=0; i<K-1; ++i) {
+        V[K-1][i] = V[i][i];
+        V[i][i] = 1.;
+        double h = d[i+1];
+        if (h != 0) {
+            for (int k=0; k<=i; ++k)
+                d[k] = V[k][i+1] / h;
+            for (int j=0; j<=i; ++j) {
+                double gamma = 0;
+                for (int k=0; k<=i; ++k)
+                    gamma += V[k][i+1] * V[k][j];
+                for (int k=0; k<=i; ++k)
+                    V[k][j] -= gamma * d[k];
+            }
+        }
+        for (int k=0; k<=i; ++k)
+            V[k][i+1] = 0;
+    }
+    for (int j=0; j<K; ++j) {
+        d[j] = V[K-1][j];
+        V[K-1][j] = 0;
+    }
+    V[K-1][K-1] = 1.;
+    e[0] = 0;
+
+    // QL algorithm with implicit shifts on the tridiagonal matrix
+    for (int i=1; i<K; ++i)
+        e[i-1] = e[i];
+    e[K-1] = 0;
+
+    double f = 0;
+    double tst1 = 0;
+    double epsilon = numeric_limits<double>::epsilon();
+    for (int l=0; l<K; ++l) {
+
+        // Finds a small subdiagonal element
+        tst1 = max(tst1, fabs(d[l]) + fabs(e[l]));
+        int last = l;
+        while (last < K-1 && fabs(e[last]) > epsilon * tst1)
+            ++last;
+
+        // If last == l, d[l] is already an eigenvalue, otherwise iterates
+        if (last > l) {
+            do {
+                double gamma = d[l];
+                double p = (d[l+1] - gamma) / (2. * e[l]);
+                double r = p < 0 ? -hypot(p,1.) : hypot(p,1.);
+                d[l] = e[l] / (p + r);
+                d[l+1] = e[l] * (p + r);
+                double dl1 = d[l+1];
+                double h = gamma - d[l];
+                for (int i=l+2; i<K; ++i)
+                    d[i] -= h;
+                f += h;
+
+                p = d[last];
+                double c = 1.;
+                double c2 = c;
+                double c3 = c;
+                double el1 = e[l+1];
+                double s = 0;
+                double s2 = 0;
+                for (int i=last-1; i>=l; --i) {
+                    c3 = c2;
+                    c2 = c;
+                    s2 = s;
+                    gamma = c * e[i];
+                    h = c * p;
+                    r = hypot(p, e[i]);
+                    e[i+1] = s * r;
+                    s = e[i] / r;
+                    c = p / r;
+                    p = c * d[i] - s * gamma;
+                    d[i+1] = h + s * (c * gamma + s * d[i]);
+                    for (int k=0; k<K; ++k) {
+                        h = V[k][i+1];
+                        V[k][i+1] = s * V[k][i] + c * h;
+                        V[k][i] = c * V[k][i] - s * h;
+                    }
+                }
+                p = -s * s2 * c3 * el1 * e[l] / dl1;
+                e[l] = s * p;
+                d[l] = c * p;
+            } while (fabs(e[l]) > epsilon * tst1);
+        }
+
+        d[l] += f;
+        e[l] = 0;
+
+    }
+
+}
@@ -14,7 +14,7 @@ with open("README.md", "r") as fh:
 
 def custom_command():
     subprocess.check_call(
-        f'g++ -std=c++17  ./SplinePoliMi/Main.cpp -o ./SplinePoliMi/SplineGenerator_{version}.o -O3 -Wall -DNDEBUG',
+        f'g++ -std=c++17  ./SplinePoliMi/Main.cpp -o ./SplinePoliMi/SplineGenerator_{version}.o -O3 -Wall -DNDEBUG -pthread',
         shell=True)
 
 
@@ -0,0 +1,405 @@
+/* Tests of the analysis of the splines passed to the C functions, on
+piecewise polynomials whose answers are known */
+
+#include "Test.h"
+
+
+
+/* Piecewise polynomial in the format of the C functions: numberOfKnots-1
+polynomials, 'stride' coefficients of the powers of x each, followed by the
+coefficients of their first and second derivatives */
+struct TestSpline {
+    vector<double> knots;
+    vector<double> coeffD0;
+    vector<double> coeffD1;
+    vector<double> coeffD2;
+    int stride;
+    int degree;
+};
+
+
+
+/* Builds the piecewise polynomial whose polynomial i, defined between knots i
+and i+1, has the coefficients polynomials[i] of the powers of x */
+TestSpline makeSpline(const vector<double>& knots,
+                      const vector<vector<double>>& polynomials) {
+
+    TestSpline spline;
+    spline.knots = knots;
+    spline.degree = 0;
+    for (const vector<double>& polynomial : polynomials)
+        spline.degree = max(spline.degree, (int)polynomial.size()-1);
+    spline.stride = spline.degree + 1;
+
+    int stride = spline.stride;
+    spline.coeffD0.assign(polynomials.size()*stride, 0);
+    spline.coeffD1.assign(polynomials.size()*stride, 0);
+    spline.coeffD2.assign(polynomials.size()*stride, 0);
+    for (int i=0; i<(int)polynomials.size(); ++i)
+        for (int a=0; a<(int)polynomials[i].size(); ++a) {
+            spline.coeffD0[i*stride+a] = polynomials[i][a];
+            if (a >= 1)
+                spline.coeffD1[i*stride+a-1] = a*polynomials[i][a];
+            if (a >= 2)
+                spline.coeffD2[i*stride+a-2] = a*(a-1)*polynomials[i][a];
+        }
+
+    return spline;
+
+}
+
+
+
+/* Builds the piecewise polynomial made of the same polynomial in every
+interval */
+TestSpline makeSplineFromPolynomial(const vector<double>& knots,
+                                    const vector<double>& polynomial) {
+
+    return makeSpline(knots,
+                      vector<vector<double>>(knots.size()-1, polynomial));
+
+}
+
+
+
+/* Returns the coefficients of the powers of x of factor*(x-r1)*(x-r2)*... */
+vector<double> polynomialFromRoots(const vector<double>& roots,
+                                   double factor = 1) {
+
+    vector<double> polynomial = {factor};
+    for (double root : roots) {
+        polynomial.push_back(0);
+        for (int a=polynomial.size()-1; a>0; --a)
+            polynomial[a] = polynomial[a-1] - root*polynomial[a];
+        polynomial[0] *= -root;
+    }
+
+    return polynomial;
+
+}
+
+
+
+/* Calculates the roots of the spline with calculate_roots, and compares them
+with the expected ones */
+void checkRoots(const TestSpline& spline,
+                const vector<double>& expected,
+                const string& description) {
+
+    vector<double> roots(expected.size()+5);
+    int numberOfRoots;
+    int status = calculate_roots((double*)spline.knots.data(),
+                                 spline.knots.size(),
+                                 (double*)spline.coeffD0.data(), spline.stride,
+                                 spline.degree, roots.data(), roots.size(),
+                                 &numberOfRoots);
+
+    check(status == 0, "status of calculate_roots, " + description);
+    check(numberOfRoots == (int)expected.size(),
+          "number of roots, " + description);
+    for (int i=0; i<min(numberOfRoots,(int)expected.size()); ++i)
+        checkClose(roots[i], expected[i], 1e-10, "root, " + description);
+
+}
+
+
+
+void testRoots() {
+
+    // Roots inside the intervals
+    checkRoots(makeSplineFromPolynomial({0., 1.5, 2.5, 4.},
+                                        polynomialFromRoots({1., 2., 3.})),
+               {1., 2., 3.}, "cubic");
+
+    // Roots of a polynomial of degree 5 spread over many intervals
+    checkRoots(makeSplineFromPolynomial(
+                   {0., 1., 2., 3., 4., 5., 6., 7., 8., 9., 10.},
+                   polynomialFromRoots({0.5, 2.2, 4.1, 6.9, 9.3}, 1e-2)),
+               {0.5, 2.2, 4.1, 6.9, 9.3}, "quintic");
+
+    // A root on a knot shared by two polynomials is reported once, and so is
+    // a change of sign on a knot
+    checkRoots(makeSpline({0., 2., 4.}, {{-2., 1.}, {-4., 2.}}), {2.},
+               "root on a knot");
+    checkRoots(makeSpline({0., 2., 4.}, {{-1.}, {1.}}), {2.},
+               "change of sign on a knot");
+
+    // Roots on the end points
+    checkRoots(makeSplineFromPolynomial({1., 2., 3.}, polynomialFromRoots({1.})),
+               {1.}, "root on the first knot");
+    checkRoots(makeSplineFromPolynomial({1., 2., 3.}, polynomialFromRoots({3.})),
+               {3.}, "root on the last knot");
+
+    // No roots, and no roots where the spline is equal to 0
+    checkRoots(makeSplineFromPolynomial({-1., 0., 1.}, {1., 0., 1.}), {},
+               "no roots");
+    checkRoots(makeSpline({0., 1., 2., 3.}, {{-1., 1.}, {0.}, {-2., 1.}}),
+               {1., 2.}, "interval equal to 0");
+
+    // With too small a buffer, the first roots are saved and their number is
+    // still returned
+    TestSpline spline =
+        makeSplineFromPolynomial({0., 1.5, 2.5, 4.},
+                                 polynomialFromRoots({1., 2., 3.}));
+    double roots[2];
+    int numberOfRoots;
+    int status = calculate_roots(spline.knots.data(), spline.knots.size(),
+                                 spline.coeffD0.data(), spline.stride,
+                                 spline.degree, roots, 2, &numberOfRoots);
+    check(status == 1 && numberOfRoots == 3, "calculate_roots, small buffer");
+    checkClose(roots[1], 2., 1e-10, "calculate_roots, small buffer");
+
+}
+
+
+
+/* Finds the extrema of the spline with find_extrema, and compares their
+abscissae, ordinates and types with the expected ones */
+void checkExtrema(const TestSpline& spline,
+                  double fraction,
+                  const vector<double>& abscissae,
+                  const vector<double>& ordinates,
+                  const vector<int>& types,
+                  const string& description) {
+
+    int size = abscissae.size() + 5;
+    vector<double> foundAbscissae(size), foundOrdinates(size);
+    vector<int> foundTypes(size);
+    int numberOfExtrema;
+    int status = find_extrema((double*)spline.knots.data(), spline.knots.size(),
+                              (double*)spline.coeffD0.data(),
+                              (double*)spline.coeffD1.data(),
+                              (double*)spline.coeffD2.data(),
+                              spline.stride, spline.degree, fraction, size,
+                              foundAbscissae.data(), foundOrdinates.data(),
+                              foundTypes.data(), &numberOfExtrema);
+
+    check(status == 0, "status of find_extrema, " + description);
+    check(numberOfExtrema == (int)abscissae.size(),
+          "number of extrema, " + description);
+    for (int i=0; i<min(numberOfExtrema,(int)abscissae.size()); ++i) {
+        string which = description + ", extremum " + to_string(i);
+        checkClose(foundAbscissae[i], abscissae[i], 1e-10, "abscissa, " + which);
+        checkClose(foundOrdinates[i], ordinates[i], 1e-12, "ordinate, " + which);
+        check(foundTypes[i] == types[i], "type, " + which);
+    }
+
+}
+
+
+
+void testExtrema() {
+
+    // -(x-1)^2*(x-3)^2 on [0.8,4] has maxima 0 at 1 and 3, a minimum -1 at 2,
+    // and the range from -9 to 0. The maximum at 1 rises by 0.1936 above the
+    // left end, so it is well-defined only up to a fraction of about 0.0215,
+    // and the one at 3 rises by 1 above the minimum, up to a fraction of 1/9
+    vector<double> quartic = polynomialFromRoots({1., 1., 3., 3.}, -1.);
+    TestSpline spline = makeSplineFromPolynomial({0.8, 1.7, 2.6, 4.}, quartic);
+    checkExtrema(spline, 0.02, {1., 2., 3.}, {0., -1., 0.}, {2, 0, 2},
+                 "two maxima, fraction 0.02");
+    checkExtrema(spline, 0.025, {1., 2., 3.}, {0., -1., 0.}, {1, 0, 2},
+                 "two maxima, fraction 0.025");
+    checkExtrema(spline, 0.12, {1., 2., 3.}, {0., -1., 0.}, {1, 0, 1},
+                 "two maxima, fraction 0.12");
+
+    // A peak of 1 at 0 is followed by a valley of 0.7 at 0.75, a small bump
+    // of 0.8 at 1.25 and the end at 0.35, the range being from 0 to 1. The
+    // prominence of the peak is measured from the end, the lowest point
+    // before a higher maximum, so it is 0.65 and not 0.3, while the bump only
+    // rises by 0.1 above the valley
+    TestSpline peak = makeSpline({-1., -0.2, 0.5, 1., 1.5, 2.},
+                                 {{1., 0., -1.},
+                                  {1., 0., -1.},
+                                  {1.15, -1.2, 0.8},
+                                  {-0.45, 2., -0.8},
+                                  {-0.45, 2., -0.8}});
+    checkExtrema(peak, 0.5, {0., 0.75, 1.25}, {1., 0.7, 0.8}, {2, 0, 1},
+                 "peak followed by a bump, fraction 0.5");
+    checkExtrema(peak, 0.7, {0., 0.75, 1.25}, {1., 0.7, 0.8}, {1, 0, 1},
+                 "peak followed by a bump, fraction 0.7");
+
+    // With too small a buffer, the first extrema are saved and their number is
+    // still returned
+    double abscissae[1], ordinates[1];
+    int types[1], numberOfExtrema;
+    int status = find_extrema(spline.knots.data(), spline.knots.size(),
+                              spline.coeffD0.data(), spline.coeffD1.data(),
+                              spline.coeffD2.data(), spline.stride,
+                              spline.degree, 0.025, 1, abscissae, ordinates,
+                              types, &numberOfExtrema);
+    check(status == 1 && numberOfExtrema == 3, "find_extrema, small buffer");
+    checkClose(abscissae[0], 1., 1e-10, "find_extrema, small buffer");
+
+}
+
+
+
+/* Removes the asymptotes of the spline with remove_asymptotes, and checks
+that the remaining intervals are those between knots 'first' and 'last' */
+void checkAsymptotes(const TestSpline& spline,
+                     double fraction,
+                     int first,
+                     int last,
+                     const string& description) {
+
+    int numberOfKnots = spline.knots.size();
+    int stride = spline.stride;
+    vector<double> knots(numberOfKnots);
+    vector<double> coeffD0(spline.coeffD0.size()), coeffD1(coeffD0.size()),
+                   coeffD2(coeffD0.size());
+    int newNumberOfKnots;
+    int status = remove_asymptotes((double*)spline.knots.data(), numberOfKnots,
+                                   (double*)spline.coeffD0.data(),
+                                   (double*)spline.coeffD1.data(),
+                                   (double*)spline.coeffD2.data(),
+                                   stride, spline.degree, fraction,
+                                   knots.data(), coeffD0.data(), coeffD1.data(),
+                                   coeffD2.data(), &newNumberOfKnots);
+
+    check(status == 0, "status of remove_asymptotes, " + description);
+    check(newNumberOfKnots == last-first+1, "number of knots, " + description);
+    if (newNumberOfKnots != last-first+1)
+        return;
+
+    for (int i=0; i<newNumberOfKnots; ++i)
+        check(knots[i] == spline.knots[first+i], "knots, " + description);
+    for (int i=0; i<(newNumberOfKnots-1)*stride; ++i)
+        check(coeffD0[i] == spline.coeffD0[first*stride+i] &&
+              coeffD1[i] == spline.coeffD1[first*stride+i] &&
+              coeffD2[i] == spline.coeffD2[first*stride+i],
+              "polynomials, " + description);
+
+}
+
+
+
+void testAsymptotes() {
+
+    // Equal to 0 up to 3, rising to 1 at 6 as 3s^2-2s^3 with s = (x-3)/3, and
+    // then equal to 1 or slowly rising with 'slope'
+    auto step = [](double slope) {
+        vector<double> rise = polynomialFromRoots({3., 3.}, 1./3.);
+        rise.push_back(0);
+        vector<double> cubic = polynomialFromRoots({3., 3., 3.}, -2./27.);
+        for (int a=0; a<4; ++a)
+            rise[a] += cubic[a];
+        vector<vector<double>> polynomials(3, {0.});
+        polynomials.insert(polynomials.end(), 3, rise);
+        polynomials.insert(polynomials.end(), 4, {1.-6.*slope, slope});
+        return makeSpline({0., 1., 2., 3., 4., 5., 6., 7., 8., 9., 10.},
+                          polynomials);
+    };
+
+    // The flat intervals at both ends are removed
+    checkAsymptotes(step(0.), 0.005, 3, 6, "step");
+
+    // With slope 0.002 the range is 1.008, and the last intervals stay within
+    // 0.00504 only from 8 to 10
+    checkAsymptotes(step(0.002), 0.005, 3, 8, "step with a slope");
+
+    // A larger fraction also removes the intervals where the rise is slow
+    checkAsymptotes(step(0.), 0.3, 4, 5, "step, fraction 0.3");
+
+    // A spline which is all asymptote is kept whole
+    checkAsymptotes(makeSplineFromPolynomial({0., 1., 2., 3., 4.}, {2.}),
+                    0.005, 0, 4, "constant");
+
+}
+
+
+
+/* Calculates the distances between the splines with spline_distance, and
+compares them with the expected ones. Returns the status */
+int checkDistance(const TestSpline& A,
+                  const TestSpline& B,
+                  const string& normalization,
+                  bool divideByDomainLength,
+                  double expectedD0,
+                  double expectedD1,
+                  const string& description) {
+
+    double distanceD0 = -1, distanceD1 = -1;
+    int status = spline_distance((double*)A.knots.data(), A.knots.size(),
+                                 (double*)A.coeffD0.data(),
+                                 (double*)A.coeffD1.data(), A.stride, A.degree,
+                                 (double*)B.knots.data(), B.knots.size(),
+                                 (double*)B.coeffD0.data(),
+                                 (double*)B.coeffD1.data(), B.stride, B.degree,
+                                 (char*)normalization.c_str(),
+                                 divideByDomainLength,
+                                 &distanceD0, &distanceD1);
+
+    if (status == 0) {
+        string which = description + ", normalization " + normalization;
+        checkClose(distanceD0, expectedD0, 1e-12, "distance, " + which);
+        checkClose(distanceD1, expectedD1, 1e-12,
+                   "distance of the derivatives, " + which);
+    }
+
+    return status;
+
+}
+
+
+
+void testDistance() {
+
+    // x and 2x^2 on [0,1], with different knots and degrees: the integrals of
+    // the squared differences are 2/15 and, for the derivatives 1 and 4x,
+    // 7/3. Divided by their largest ordinates, 1 and 2, they are 1/30 and 1/3
+    TestSpline line = makeSplineFromPolynomial({0., 0.5, 1.}, {0., 1.});
+    TestSpline parabola = makeSplineFromPolynomial({0., 1./3., 1.},
+                                                   {0., 0., 2.});
+    check(checkDistance(line, parabola, "none", false, sqrt(2./15.),
+                        sqrt(7./3.), "x and 2x^2") == 0,
+          "status of spline_distance, x and 2x^2");
+    check(checkDistance(line, parabola, "reference", false, sqrt(2./15.),
+                        sqrt(7./3.), "x and 2x^2") == 0,
+          "status of spline_distance, x and 2x^2, reference");
+    check(checkDistance(line, parabola, "individual", false, sqrt(1./30.),
+                        sqrt(1./3.), "x and 2x^2") == 0,
+          "status of spline_distance, x and 2x^2, individual");
+    check(checkDistance(parabola, parabola, "none", false, 0., 0.,
+                        "2x^2 and itself") == 0,
+          "status of spline_distance, 2x^2 and itself");
+
+    // x on [0,3] and x^2 on [1,4] are compared on [1,3], where the integrals
+    // are 256/15 and 62/3, divided by the length 2 of the intersection
+    TestSpline A = makeSplineFromPolynomial({0., 1., 2., 3.}, {0., 1.});
+    TestSpline B = makeSplineFromPolynomial({1., 2.5, 4.}, {0., 0., 1.});
+    check(checkDistance(A, B, "none", false, sqrt(256./15.), sqrt(62./3.),
+                        "intersection") == 0,
+          "status of spline_distance, intersection");
+    check(checkDistance(A, B, "none", true, sqrt(128./15.), sqrt(31./3.),
+                        "intersection divided by its length") == 0,
+          "status of spline_distance, intersection divided by its length");
+
+    // Domains which do not intersect, unknown normalizations and splines
+    // equal to 0 which would be normalized are errors
+    TestSpline far = makeSplineFromPolynomial({5., 6.}, {0., 1.});
+    TestSpline zero = makeSplineFromPolynomial({0., 1.}, {0.});
+    check(checkDistance(line, far, "none", false, 0, 0, "") == 1,
+          "spline_distance, domains which do not intersect");
+    check(checkDistance(line, parabola, "unknown", false, 0, 0, "") == 1,
+          "spline_distance, unknown normalization");
+    check(checkDistance(line, zero, "individual", false, 0, 0, "") == 1,
+          "spline_distance, spline equal to 0 normalized individually");
+    check(checkDistance(line, zero, "reference", false, sqrt(1./3.), 1.,
+                        "x and 0") == 0,
+          "status of spline_distance, x and 0, reference");
+
+}
+
+
+
+int main() {
+
+    testRoots();
+    testExtrema();
+    testAsymptotes();
+    testDistance();
+
+    return testResult("AnalysisTest");
+
+}
@@ -0,0 +1,177 @@
+/* Tests of BandMatrix: the LDLT factorization, the solution of linear systems
+and the selected inverse, compared with dense calculations */
+
+#include "Test.h"
+
+
+
+/* Solves random systems with a band matrix, and checks the solution against
+Gaussian elimination on the same matrix stored densely */
+void testSolveAgainstDense() {
+
+    mt19937 generator(1);
+    uniform_real_distribution<double> distribution(-1., 1.);
+
+    for (int K : {1, 2, 5, 40})
+        for (int bandwidth : {0, 1, 3, 6}) {
+
+            BandMatrix M;
+            M.resize(K, bandwidth);
+            randomPositiveDefinite(M, generator);
+
+            vector<long double> b(K);
+            vector<double> x(K);
+            for (int i=0; i<K; ++i)
+                x[i] = b[i] = distribution(generator);
+
+            vector<double> expected = solveDense(denseMatrix(M), b);
+
+            M.factorize();
+            M.solve(x);
+
+            string description = "solve, K " + to_string(K) +
+                                 ", bandwidth " + to_string(bandwidth);
+            for (int i=0; i<K; ++i)
+                checkClose(x[i], expected[i], 1e-12, description);
+
+        }
+
+}
+
+
+
+/* Solves a system with a penalty-like matrix, the second differences plus a
+small multiple of the identity, which is badly conditioned as the matrices of
+the smoothing problem with a large lambda */
+void testSolveIllConditioned() {
+
+    int K = 30;
+    BandMatrix M;
+    M.resize(K, 2);
+    for (int i=0; i<K-2; ++i) {
+        double d[3] = {1., -2., 1.};
+        for (int a=0; a<3; ++a)
+            for (int c=0; c<=a; ++c)
+                M(i+a,i+c) += d[a]*d[c];
+    }
+    for (int i=0; i<K; ++i)
+        M(i,i) += 1e-6;
+
+    vector<long double> b(K);
+    vector<double> x(K);
+    for (int i=0; i<K; ++i)
+        x[i] = b[i] = sin(i);
+
+    vector<vector<long double>> A = denseMatrix(M);
+    vector<double> expected = solveDense(A, b);
+
+    M.factorize();
+    M.solve(x);
+
+    // The solution itself is sensitive to rounding: check the residual
+    double normOfExpected = 0;
+    for (int i=0; i<K; ++i)
+        normOfExpected = max(normOfExpected, fabs(expected[i]));
+    for (int i=0; i<K; ++i) {
+        long double residual = -b[i];
+        for (int j=0; j<K; ++j)
+            residual += A[i][j] * x[j];
+        checkClose((double)residual, 0., 1e-9, "residual, ill-conditioned");
+        checkClose(x[i]/normOfExpected, expected[i]/normOfExpected, 1e-6,
+                   "solve, ill-conditioned");
+    }
+
+}
+
+
+
+/* Checks that solve() equals the forward substitution, the division by D and
+the backward substitution made separately */
+void testSubstitutions() {
+
+    mt19937 generator(2);
+    BandMatrix M;
+    M.resize(25, 4);
+    randomPositiveDefinite(M, generator);
+    M.factorize();
+
+    vector<double> x(25), y(25);
+    for (int i=0; i<25; ++i)
+        x[i] = y[i] = cos(i);
+
+    M.solve(x);
+    M.forwardSubstitution(y);
+    for (int i=0; i<25; ++i)
+        y[i] /= M(i,i);
+    M.backwardSubstitution(y);
+
+    for (int i=0; i<25; ++i)
+        checkClose(x[i], y[i], 1e-14, "substitutions");
+
+}
+
+
+
+/* Checks the elements of the selected inverse against the inverse obtained
+from dense solves, and the trace of its product with another band matrix, as
+used for the trace of the influence matrix in GCV1, against the trace of the
+explicit product */
+void testSelectedInverse() {
+
+    mt19937 generator(3);
+
+    for (int K : {1, 4, 30})
+        for (int bandwidth : {0, 2, 5}) {
+
+            BandMatrix A, B, M;
+            A.resize(K, bandwidth);
+            B.resize(K, bandwidth);
+            randomPositiveDefinite(A, generator);
+            randomPositiveDefinite(B, generator);
+
+            // M = A + lambda*B, as FiTFi + lambda*R in the smoothing problem
+            M.resize(K, bandwidth);
+            M.sum(A, 0.37, B);
+            vector<vector<long double>> denseM = denseMatrix(M);
+
+            vector<vector<double>> inverse(K);
+            for (int j=0; j<K; ++j) {
+                vector<long double> unit(K, 0);
+                unit[j] = 1;
+                inverse[j] = solveDense(denseM, unit);
+            }
+
+            BandMatrix selected;
+            M.factorize();
+            M.selectedInverse(selected);
+
+            string description = "K " + to_string(K) +
+                                 ", bandwidth " + to_string(bandwidth);
+            for (int i=0; i<K; ++i)
+                for (int j=max(0,i-M.bandwidth); j<=i; ++j)
+                    checkClose(selected(i,j), inverse[j][i], 1e-12,
+                               "selected inverse, " + description);
+
+            long double trace = 0;
+            for (int i=0; i<K; ++i)
+                for (int j=max(0,i-B.bandwidth); j<=min(K-1,i+B.bandwidth); ++j)
+                    trace += inverse[i][j] * B(j,i);
+            checkClose(selected.traceOfProduct(B), (double)trace, 1e-12,
+                       "trace of product, " + description);
+
+        }
+
+}
+
+
+
+int main() {
+
+    testSolveAgainstDense();
+    testSolveIllConditioned();
+    testSubstitutions();
+    testSelectedInverse();
+
+    return testResult("BandMatrixTest");
+
+}
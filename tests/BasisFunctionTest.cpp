@@ -0,0 +1,271 @@
+/* Tests of BasisFunctions: the polynomials of the basis functions, obtained
+with the Cox-de Boor recurrence or from the cardinal B-splines, compared with
+the recursive definition of the B-splines, and the penalty calculated from the
+cardinal B-splines */
+
+#include "Test.h"
+
+
+
+/* Value at x of derivative r of the B-spline i of degree d defined on
+'knots', from the recursive definitions of the B-splines and of their
+derivatives. Terms with coincident knots are 0 */
+long double referenceBasis(const vector<double>& knots,
+                           int i,
+                           int d,
+                           int r,
+                           long double x) {
+
+    long double left = knots[i+d] - knots[i];
+    long double right = knots[i+d+1] - knots[i+1];
+
+    if (r > 0) {
+        long double value = 0;
+        if (left > 0)
+            value += d * referenceBasis(knots, i, d-1, r-1, x) / left;
+        if (right > 0)
+            value -= d * referenceBasis(knots, i+1, d-1, r-1, x) / right;
+        return value;
+    }
+
+    if (d == 0)
+        return knots[i] <= x && x < knots[i+1] ? 1 : 0;
+
+    long double value = 0;
+    if (left > 0)
+        value += (x-knots[i]) / left * referenceBasis(knots, i, d-1, 0, x);
+    if (right > 0)
+        value += (knots[i+d+1]-x) / right *
+                 referenceBasis(knots, i+1, d-1, 0, x);
+    return value;
+
+}
+
+
+
+/* Compares the basis functions calculated on 'knots' and their first and
+second derivatives with the reference values, at points inside each knot
+interval. The basis functions of the library are multiplied by maxHeight */
+void checkBasisFunctions(const vector<double>& knots,
+                         int g,
+                         bool expectedUniform,
+                         const string& description) {
+
+    BasisFunctions basisFunctions;
+    basisFunctions.calculateCoefficients(knots, g);
+    check(basisFunctions.uniform == expectedUniform,
+          "detection of equally spaced knots, " + description);
+
+    int numberOfKnots = knots.size();
+    int m = g + 1;
+    double spacing = (knots.back()-knots[0]) / (double)(numberOfKnots-1);
+    double maxHeight = spacing * (double)m;
+
+    for (int q=0; q<numberOfKnots-1; ++q)
+        for (double t : {0.0, 0.13, 0.5, 0.87}) {
+
+            double x = knots[q] + t*(knots[q+1]-knots[q]);
+            string at = description + ", x " + to_string(x);
+
+            double sum = 0;
+            for (int j=0; j<basisFunctions.K; ++j) {
+                double value = basisFunctions.D0(j, x);
+                sum += value;
+                checkClose(value/maxHeight,
+                           (double)referenceBasis(knots, j, g, 0, x), 1e-10,
+                           "value, " + at);
+                if (g >= 1)
+                    checkClose(basisFunctions.D1(j, x)/maxHeight*spacing,
+                               (double)referenceBasis(knots, j, g, 1, x)*spacing,
+                               1e-9, "first derivative, " + at);
+                if (g >= 2)
+                    checkClose(basisFunctions.D2(j, x)/maxHeight*spacing*spacing,
+                               (double)referenceBasis(knots, j, g, 2, x) *
+                               spacing*spacing,
+                               1e-8, "second derivative, " + at);
+            }
+
+            // Between knot g and knot numberOfKnots-1-g all the basis functions
+            // non-zero at x are complete, and they sum to 1
+            if (q >= g && q < numberOfKnots-1-g)
+                checkClose(sum/maxHeight, 1., 1e-10, "partition of unity, " + at);
+
+        }
+
+}
+
+
+
+/* Basis functions on unequally spaced knots, built with the Cox-de Boor
+recurrence */
+void testCoxDeBoor() {
+
+    mt19937 generator(4);
+    uniform_real_distribution<double> distribution(0.6, 1.4);
+
+    // The knots are kept close to the origin, since the coefficients of the
+    // powers of x lose precision far from it
+    for (int g=1; g<=6; ++g) {
+        vector<double> knots = {-2.5};
+        for (int i=0; i<g+12; ++i)
+            knots.push_back(knots.back() + 5./(g+12)*distribution(generator));
+        checkBasisFunctions(knots, g, false, "unequal knots, g " + to_string(g));
+    }
+
+}
+
+
+
+/* Compares the tabulated polynomials of the cardinal B-splines with the
+recursive definition on the knots 0, 1, ..., g+1 */
+void testCardinalTables() {
+
+    double factorial = 1;
+    for (int g=0; g<=maximumCardinalDegree; ++g) {
+
+        if (g > 1)
+            factorial *= g;
+
+        vector<double> knots(g+2);
+        for (int i=0; i<=g+1; ++i)
+            knots[i] = i;
+
+        for (int p=0; p<=g; ++p)
+            for (double s : {0.0, 0.25, 0.5, 0.9}) {
+                double value = 0;
+                for (int a=g; a>=0; --a)
+                    value = value*s + cardinalBSplines[g][p][a];
+                checkClose(value/factorial,
+                           (double)referenceBasis(knots, 0, g, 0, p+s), 1e-15,
+                           "cardinal B-spline, g " + to_string(g) +
+                           ", polynomial " + to_string(p));
+            }
+
+    }
+
+}
+
+
+
+/* Basis functions on equally spaced knots, built from the cardinal
+B-splines */
+void testEquallySpaced() {
+
+    for (int g=0; g<=maximumCardinalDegree; ++g) {
+        vector<double> knots;
+        for (int i=0; i<g+14; ++i)
+            knots.push_back(-2.5 + 0.4*i);
+        checkBasisFunctions(knots, g, true, "equal knots, g " + to_string(g));
+    }
+
+}
+
+
+
+/* Compares the penalty calculated from the cardinal B-splines with the one
+assembled with Gauss-Legendre quadrature, obtained by moving one knot just
+enough for the knots not to be considered equally spaced */
+void testCardinalPenalty() {
+
+    for (int g=2; g<=maximumCardinalDegree; ++g) {
+
+        vector<double> knots;
+        for (int i=0; i<g+14; ++i)
+            knots.push_back(-2.5 + 0.4*i);
+
+        BasisFunctions cardinal, deBoor;
+        BandMatrix R, reference;
+        cardinal.calculateCoefficients(knots, g);
+        cardinal.calculatePenalty(R);
+
+        knots[g+5] += 1e-9;
+        deBoor.calculateCoefficients(knots, g);
+        deBoor.calculatePenalty(reference);
+
+        string description = "penalty, g " + to_string(g);
+        check(cardinal.uniform && !deBoor.uniform,
+              "detection of equally spaced knots, " + description);
+        check(R.K == reference.K && R.bandwidth == reference.bandwidth,
+              "dimensions, " + description);
+        if (R.elements.size() != reference.elements.size())
+            continue;
+
+        double norm = reference.norm();
+        for (int i=0; i<(int)R.elements.size(); ++i)
+            checkClose(R.elements[i]/norm, reference.elements[i]/norm, 1e-7,
+                       description);
+
+    }
+
+}
+
+
+
+/* Compares the difference penalty with the product DTD calculated from the
+dense matrix D of the differences, for a few basis functions */
+void testDifferencePenalty() {
+
+    for (int g : {2, 3})
+        for (int order : {1, 2, 3}) {
+
+            // Seven basis functions
+            vector<double> knots;
+            for (int i=0; i<g+8; ++i)
+                knots.push_back(-1. + 0.5*i);
+
+            BasisFunctions basisFunctions;
+            BandMatrix R;
+            basisFunctions.calculateCoefficients(knots, g);
+            basisFunctions.calculateDifferencePenalty(order, R);
+            int K = R.K;
+
+            // Rows of D: the differences of the given order of the
+            // coefficients, obtained by differencing the identity order times
+            vector<vector<double>> D(K, vector<double>(K, 0));
+            for (int i=0; i<K; ++i)
+                D[i][i] = 1;
+            for (int o=0; o<order; ++o)
+                for (int r=0; r+o+1<K; ++r)
+                    for (int k=0; k<K; ++k)
+                        D[r][k] = D[r+1][k] - D[r][k];
+            D.resize(K-order);
+
+            string description = "difference penalty, g " + to_string(g) +
+                                 ", order " + to_string(order);
+            check(K == 7 && R.bandwidth == max(g, order),
+                  "dimensions, " + description);
+
+            for (int i=0; i<K; ++i)
+                for (int j=max(0,i-R.bandwidth); j<=i; ++j) {
+                    double expected = 0;
+                    for (auto& row : D)
+                        expected += row[i]*row[j];
+                    checkClose(R(i,j), expected, 1e-15, description + ", (" +
+                               to_string(i) + "," + to_string(j) + ")");
+                }
+
+            // The second differences give the well-known rows 1 -2 1,
+            // -2 5 -4 1 and 1 -4 6 -4 1 away from the ends
+            if (order == 2)
+                check(R(0,0) == 1 && R(1,0) == -2 && R(2,0) == 1 &&
+                      R(1,1) == 5 && R(2,1) == -4 && R(3,1) == 1 &&
+                      R(2,2) == 6 && R(3,2) == -4 && R(4,2) == 1,
+                      "rows of the second differences, " + description);
+
+        }
+
+}
+
+
+
+int main() {
+
+    testCoxDeBoor();
+    testCardinalTables();
+    testEquallySpaced();
+    testCardinalPenalty();
+    testDifferencePenalty();
+
+    return testResult("BasisFunctionTest");
+
+}
@@ -0,0 +1,268 @@
+/* Tests of the C functions called by Spline.py, with the default settings of
+Spline.py */
+
+#include "Test.h"
+
+
+
+char criterion[] = "AIC";
+char lambdaOptimizer[] = "grid";
+char solver[] = "banded";
+char penalty[] = "integral";
+int candidates[] = {0, 2, 5};
+const int g = 3;
+const int m = g+1;
+
+
+
+/* Output of compute_spline_cpp for a single curve, with room for one knot for
+each data point */
+struct SingleSpline {
+    int status;
+    int numberOfKnots;
+    int numberOfPolynomials;
+    int numberOfLambdaEvaluations;
+    vector<double> coeffD0, coeffD1, coeffD2, knots;
+};
+
+
+
+/* Calculates the spline of a curve with compute_spline_cpp */
+SingleSpline computeSpline(vector<double> x, vector<double> y) {
+
+    int n = x.size();
+    SingleSpline spline;
+    spline.coeffD0.assign(n*m, 0);
+    spline.coeffD1.assign(n*m, 0);
+    spline.coeffD2.assign(n*m, 0);
+    spline.knots.assign(n, 0);
+
+    spline.status = compute_spline_cpp(
+        x.data(), y.data(), n, 0,
+        &spline.numberOfKnots, &spline.numberOfPolynomials,
+        spline.coeffD0.data(), spline.coeffD1.data(), spline.coeffD2.data(),
+        spline.knots.data(),
+        false,
+        g, 6, 13, 40, 0.005, 0.025, 500, criterion,
+        lambdaOptimizer, 1e-3, 30, 5, solver, penalty, 2,
+        1, candidates, 3, 1,
+        &spline.numberOfLambdaEvaluations);
+
+    return spline;
+
+}
+
+
+
+/* Input and output of compute_splines_batch */
+struct Batch {
+    vector<double> x, y;
+    vector<int> offsets{0}, splineTypes, knotsOffsets{0};
+    vector<int> numberOfKnots, numberOfPolynomials, numberOfLambdaEvaluations;
+    vector<int> status;
+    vector<double> coeffD0, coeffD1, coeffD2, knots;
+
+    /* Appends a curve, with room for numberOfKnots knots in the output */
+    void add(const vector<double>& X, const vector<double>& Y, int splineType,
+             int NumberOfKnots) {
+        x.insert(x.end(), X.begin(), X.end());
+        y.insert(y.end(), Y.begin(), Y.end());
+        offsets.push_back(x.size());
+        splineTypes.push_back(splineType);
+        knotsOffsets.push_back(knotsOffsets.back() + NumberOfKnots);
+    }
+};
+
+
+
+/* Calculates the splines of the curves of the batch with
+compute_splines_batch, and returns its result */
+int computeBatch(Batch& batch, int numberOfThreads) {
+
+    int numberOfCurves = batch.splineTypes.size();
+    batch.numberOfKnots.assign(numberOfCurves, -1);
+    batch.numberOfPolynomials.assign(numberOfCurves, -1);
+    batch.numberOfLambdaEvaluations.assign(numberOfCurves, -1);
+    batch.status.assign(numberOfCurves, -1);
+    batch.coeffD0.assign(batch.knotsOffsets.back()*m, 0);
+    batch.coeffD1.assign(batch.knotsOffsets.back()*m, 0);
+    batch.coeffD2.assign(batch.knotsOffsets.back()*m, 0);
+    batch.knots.assign(batch.knotsOffsets.back(), 0);
+
+    return compute_splines_batch(
+        numberOfCurves,
+        batch.x.data(), batch.y.data(), batch.offsets.data(),
+        batch.splineTypes.data(), batch.knotsOffsets.data(),
+        batch.numberOfKnots.data(), batch.numberOfPolynomials.data(),
+        batch.coeffD0.data(), batch.coeffD1.data(), batch.coeffD2.data(),
+        batch.knots.data(), batch.numberOfLambdaEvaluations.data(),
+        batch.status.data(),
+        numberOfThreads,
+        g, 6, 13, 40, 0.005, 0.025, 500, criterion,
+        lambdaOptimizer, 1e-3, 30, 5, solver, penalty, 2,
+        candidates, 3);
+
+}
+
+
+
+/* Checks the status of each kind of curve in a batch, and that the fitted
+curves have the same spline as with compute_spline_cpp */
+void testBatch() {
+
+    vector<double> x, y, shortX, shortY, otherX, otherY;
+    testData(60, x, y);
+    testData(35, shortX, shortY);
+    testData(45, otherX, otherY);
+    for (double& yi : otherY)
+        yi = 2.*yi - 0.5;
+
+    vector<double> decreasingX(x.rbegin(), x.rend());
+    vector<double> nonFiniteY = y;
+    nonFiniteY[10] = NAN;
+
+    Batch batch;
+    batch.add(x, y, 0, x.size());                   // Fitted
+    batch.add({1.}, {1.}, 0, 1);                    // Too short
+    batch.add(decreasingX, y, 0, x.size());         // Invalid data
+    batch.add(x, nonFiniteY, 0, x.size());          // Invalid data
+    batch.add(x, y, 7, x.size());                   // Invalid data
+    batch.add(shortX, shortY, 0, 3);                // Output too small
+    batch.add(otherX, otherY, 0, otherX.size());    // Fitted
+
+    for (int numberOfThreads : {1, 3}) {
+
+        string threads = to_string(numberOfThreads) + " threads";
+        int numberOfFailures = computeBatch(batch, numberOfThreads);
+
+        check(numberOfFailures == 5, "number of failures, " + threads);
+        vector<int> expected{curveFitted, curveTooShort, curveInvalidData,
+                             curveInvalidData, curveInvalidData,
+                             curveOutputTooSmall, curveFitted};
+        check(batch.status == expected, "status of the curves, " + threads);
+        check(batch.numberOfKnots[5] > 3,
+              "number of knots of a curve whose knots do not fit, " + threads);
+
+        int curves[] = {0, 6};
+        for (int i : curves) {
+
+            string curve = "curve " + to_string(i) + ", " + threads;
+            int first = batch.offsets[i];
+            int last = batch.offsets[i+1];
+            SingleSpline single = computeSpline(
+                vector<double>(batch.x.begin() + first, batch.x.begin() + last),
+                vector<double>(batch.y.begin() + first, batch.y.begin() + last));
+
+            check(single.status == 0, "status of compute_spline_cpp, " + curve);
+            check(batch.numberOfKnots[i] == single.numberOfKnots &&
+                  batch.numberOfPolynomials[i] == single.numberOfPolynomials &&
+                  batch.numberOfLambdaEvaluations[i] ==
+                      single.numberOfLambdaEvaluations,
+                  "sizes of the spline, " + curve);
+
+            int firstKnot = batch.knotsOffsets[i];
+            int numberOfCoefficients = single.numberOfPolynomials*m;
+            check(equal(single.knots.begin(),
+                        single.knots.begin() + single.numberOfKnots,
+                        batch.knots.begin() + firstKnot),
+                  "knots, " + curve);
+            check(equal(single.coeffD0.begin(),
+                        single.coeffD0.begin() + numberOfCoefficients,
+                        batch.coeffD0.begin() + firstKnot*m) &&
+                  equal(single.coeffD1.begin(),
+                        single.coeffD1.begin() + numberOfCoefficients,
+                        batch.coeffD1.begin() + firstKnot*m) &&
+                  equal(single.coeffD2.begin(),
+                        single.coeffD2.begin() + numberOfCoefficients,
+                        batch.coeffD2.begin() + firstKnot*m),
+                  "coefficients, " + curve);
+
+        }
+
+    }
+
+}
+
+
+
+/* Checks that offsets which do not start from 0 or decrease are rejected
+before any curve is calculated */
+void testInvalidOffsets() {
+
+    vector<double> x, y;
+    testData(30, x, y);
+
+    for (int kind=0; kind<4; ++kind) {
+
+        Batch batch;
+        batch.add(x, y, 0, x.size());
+        batch.add(x, y, 0, x.size());
+        if (kind == 0)
+            batch.offsets[0] = 1;
+        else if (kind == 1)
+            batch.knotsOffsets[0] = 1;
+        else if (kind == 2)
+            batch.offsets[1] = batch.offsets[2] + 1;
+        else
+            batch.knotsOffsets[2] = batch.knotsOffsets[1] - 1;
+
+        int result = computeBatch(batch, 1);
+
+        check(result == -1, "invalid offsets rejected, kind " +
+                            to_string(kind));
+        check(batch.status == vector<int>{-1, -1},
+              "no status set, kind " + to_string(kind));
+
+    }
+
+}
+
+
+
+/* Checks that unknown names of the lambda optimizer, of the solver and of the
+penalty are rejected, instead of falling back to the default */
+void testUnknownNames() {
+
+    vector<double> x, y;
+    testData(30, x, y);
+    char unknown[] = "unknown";
+
+    for (char* name : {lambdaOptimizer, solver, penalty}) {
+
+        string description = string("unknown name in place of ") + name;
+        Settings settings;
+        check(!makeSettings(g, 6, 13, 40, 0.005, 0.025, 500, criterion,
+                            name == lambdaOptimizer ? unknown : lambdaOptimizer,
+                            1e-3, 30, 5,
+                            name == solver ? unknown : solver,
+                            name == penalty ? unknown : penalty, 2,
+                            1, candidates, 3, 1, settings),
+              description);
+
+    }
+
+    Settings settings;
+    char brent[] = "brent";
+    char demmlerReinsch[] = "demmlerReinsch";
+    char difference[] = "difference";
+    check(makeSettings(g, 6, 13, 40, 0.005, 0.025, 500, criterion,
+                       brent, 1e-3, 30, 5, demmlerReinsch, difference, 2,
+                       1, candidates, 3, 1, settings) &&
+          settings.lambdaOptimizer == lambdaOptimizerBrent &&
+          settings.solver == solverDemmlerReinsch &&
+          settings.penalty == penaltyDifference,
+          "names parsed by makeSettings");
+
+}
+
+
+
+int main() {
+
+    testBatch();
+    testInvalidOffsets();
+    testUnknownNames();
+
+    return testResult("ComputeSplineTest");
+
+}
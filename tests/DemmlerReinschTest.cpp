@@ -0,0 +1,113 @@
+/* Tests of the Demmler-Reinsch basis, compared with the factorization of the
+band matrix M for each lambda */
+
+#include "Test.h"
+
+
+
+/* Calculates the coefficients, the trace of S and GCV1 with the factorization
+of M and with the Demmler-Reinsch basis, for the matrices of a fit and for a
+range of lambdas around the one balancing FiTFi and R */
+void testAgainstBanded(Penalty penalty, int degree) {
+
+    vector<double> x, y;
+    testData(80, x, y);
+    Settings settings = testSettings(degree);
+    settings.penalty = penalty;
+
+    SplineWorkspace workspace;
+    Spline spline = fitSpline(x, y, settings, workspace);
+
+    GCV1Function GCV1;
+    GCV1.FiTFi = &workspace.FiTFi;
+    GCV1.R = &workspace.R;
+    GCV1.FiTy = &workspace.FiTy;
+    GCV1.FiD1 = &workspace.FiD1;
+    GCV1.estimatedD1 = &spline.data->estimatedD1;
+    GCV1.n = spline.n;
+
+    double log10lambda0 =
+        round(2.*(log10(workspace.FiTFi.norm())-log10(workspace.R.norm())))/2.;
+    DemmlerReinsch demmlerReinsch;
+    bool calculated = demmlerReinsch.calculate(workspace.FiTFi,
+                                               workspace.R,
+                                               workspace.FiTy,
+                                               pow(10.,log10lambda0));
+    string description = string(penaltyNames[penalty]) + " penalty, degree " +
+                         to_string(degree);
+    check(calculated, "basis calculated, " + description);
+    if (!calculated)
+        return;
+
+    GCV1Function GCV1DemmlerReinsch = GCV1;
+    GCV1DemmlerReinsch.demmlerReinsch = &demmlerReinsch;
+
+    GCV1Workspace banded, diagonal;
+    vector<double> coefficients, coefficientsDemmlerReinsch;
+
+    for (double log10lambda = log10lambda0-3.; log10lambda <= log10lambda0+3.;
+         log10lambda += 0.5) {
+
+        double value = GCV1(log10lambda, banded, coefficients);
+        double valueDemmlerReinsch =
+            GCV1DemmlerReinsch(log10lambda, diagonal, coefficientsDemmlerReinsch);
+
+        string at = description + ", log10lambda " + to_string(log10lambda);
+        checkClose(valueDemmlerReinsch, value, 1e-7, "GCV1, " + at);
+        checkClose(diagonal.traceS, banded.traceS, 1e-9, "trace of S, " + at);
+
+        double largest = 0;
+        for (double c : coefficients)
+            largest = max(largest, fabs(c));
+        check(coefficientsDemmlerReinsch.size() == coefficients.size(),
+              "number of coefficients, " + at);
+        for (int k=0; k<(int)coefficients.size(); ++k)
+            checkClose(coefficientsDemmlerReinsch[k]/largest,
+                       coefficients[k]/largest, 1e-9,
+                       "coefficients, " + at);
+
+    }
+
+}
+
+
+
+/* Checks that whole fits with the two solvers give the same spline */
+void testFits() {
+
+    vector<double> x, y;
+    testData(120, x, y);
+
+    for (LambdaOptimizer lambdaOptimizer :
+         {lambdaOptimizerGrid, lambdaOptimizerBrent}) {
+
+        string optimizer = lambdaOptimizerNames[lambdaOptimizer];
+        Settings settings = testSettings();
+        settings.lambdaOptimizer = lambdaOptimizer;
+        SplineWorkspace workspace;
+        Spline banded = fitSpline(x, y, settings, workspace);
+        settings.solver = solverDemmlerReinsch;
+        Spline diagonal = fitSpline(x, y, settings, workspace);
+
+        checkClose(diagonal.traceS, banded.traceS, 1e-6,
+                   "trace of S of the fit, " + optimizer);
+        for (double xi = 0.; xi <= 10.; xi += 0.25)
+            checkClose(diagonal.D0(xi), banded.D0(xi), 1e-6,
+                       "fitted spline, " + optimizer);
+
+    }
+
+}
+
+
+
+int main() {
+
+    for (int degree : {3, 5})
+        for (Penalty penalty : {penaltyIntegral, penaltyDifference})
+            testAgainstBanded(penalty, degree);
+    testFits();
+
+    return testResult("DemmlerReinschTest");
+
+}
@@ -0,0 +1,137 @@
+/* Tests of the evaluation of the splines passed to the C functions, compared
+with Spline::D0, D1 and D2 */
+
+#include "Test.h"
+
+
+
+/* Evaluates the spline and its derivatives with evaluate_spline at unsorted
+abscissae, at the knots and at the end points, and compares the results with
+those of the spline itself */
+void testEvaluateSpline(int degree) {
+
+    vector<double> x, y;
+    testData(60, x, y);
+    SplineWorkspace workspace;
+    Spline spline = fitSpline(x, y, testSettings(degree), workspace);
+
+    int m = spline.m;
+    vector<double> knots = spline.knots;
+    vector<vector<double>> coefficients = {flatCoefficients(spline.coeffD0, m),
+                                           flatCoefficients(spline.coeffD1, m),
+                                           flatCoefficients(spline.coeffD2, m)};
+
+    vector<double> points = knots;
+    mt19937 generator(5);
+    uniform_real_distribution<double> distribution(knots.front(), knots.back());
+    for (int i=0; i<200; ++i)
+        points.push_back(distribution(generator));
+    shuffle(points.begin(), points.end(), generator);
+
+    for (int derivative=0; derivative<=2; ++derivative) {
+
+        vector<double> values(points.size());
+        int status = evaluate_spline(knots.data(), knots.size(),
+                                     coefficients[derivative].data(), m,
+                                     degree-derivative,
+                                     points.data(), points.size(),
+                                     values.data());
+
+        string description = "derivative " + to_string(derivative) +
+                             ", degree " + to_string(degree);
+        check(status == 0, "status of evaluate_spline, " + description);
+
+        for (int i=0; i<(int)points.size(); ++i) {
+            double expected = derivative == 0 ? spline.D0(points[i]) :
+                              derivative == 1 ? spline.D1(points[i]) :
+                                                spline.D2(points[i]);
+            checkClose(values[i], expected, 1e-12,
+                       "evaluate_spline, " + description);
+        }
+
+    }
+
+    double value;
+    check(evaluate_spline(knots.data(), 1, coefficients[0].data(), m, degree,
+                          &value, 0, &value) == 1,
+          "evaluate_spline with one knot");
+    check(evaluate_spline(knots.data(), knots.size(), coefficients[0].data(),
+                          m, m, &value, 0, &value) == 1,
+          "evaluate_spline with degree equal to stride");
+
+}
+
+
+
+/* Samples the spline and its derivatives with sample_spline, with positive
+and negative steps, and compares the results with those of the spline
+itself */
+void testSampleSpline(int degree) {
+
+    vector<double> x, y;
+    testData(60, x, y);
+    SplineWorkspace workspace;
+    Spline spline = fitSpline(x, y, testSettings(degree), workspace);
+
+    int m = spline.m;
+    vector<double> knots = spline.knots;
+    vector<double> coefficients = flatCoefficients(spline.coeffD0, m);
+    double length = knots.back() - knots.front();
+
+    // Forward and backward over the whole spline, with steps that do and do
+    // not land on the knots, and backward over a part of it
+    struct Sampling { double start; double step; int numberOfPoints; };
+    vector<Sampling> samplings = {
+        {knots.front(), length/499., 500},
+        {knots.back(), -length/499., 500},
+        {knots.front() + 0.1, length/37., 30},
+        {knots.back() - 0.3, -length/41., 25},
+        {0.5*(knots.front()+knots.back()), 0., 3}};
+
+    for (const Sampling& s : samplings) {
+
+        vector<double> d0(s.numberOfPoints), d1(s.numberOfPoints),
+                       d2(s.numberOfPoints);
+        int status = sample_spline(knots.data(), knots.size(),
+                                   coefficients.data(), m, degree,
+                                   s.start, s.step, s.numberOfPoints,
+                                   d0.data(), d1.data(), d2.data());
+
+        string description = "start " + to_string(s.start) + ", step " +
+                             to_string(s.step) + ", degree " + to_string(degree);
+        check(status == 0, "status of sample_spline, " + description);
+
+        // sample_spline evaluates the polynomials in the distance from their
+        // left knot, and the spline in powers of x, whose rounding errors grow
+        // with the degree and with the distance from the origin
+        for (int i=0; i<s.numberOfPoints; ++i) {
+            double xi = s.start + i*s.step;
+            checkClose(d0[i], spline.D0(xi), 1e-10, "D0, " + description);
+            checkClose(d1[i], spline.D1(xi), 1e-9, "D1, " + description);
+            checkClose(d2[i], spline.D2(xi), 1e-8, "D2, " + description);
+        }
+
+        // The derivatives which are not needed can be omitted
+        vector<double> alone(s.numberOfPoints);
+        sample_spline(knots.data(), knots.size(), coefficients.data(), m,
+                      degree, s.start, s.step, s.numberOfPoints,
+                      nullptr, alone.data(), nullptr);
+        for (int i=0; i<s.numberOfPoints; ++i)
+            check(alone[i] == d1[i], "D1 alone, " + description);
+
+    }
+
+}
+
+
+
+int main() {
+
+    for (int degree : {3, 5}) {
+        testEvaluateSpline(degree);
+        testSampleSpline(degree);
+    }
+
+    return testResult("EvaluationTest");
+
+}
@@ -0,0 +1,177 @@
+/* Tests of the minimization of GCV1 with respect to log10lambda */
+
+#include "Test.h"
+
+
+
+/* Fits a spline to the test data, and collects in GCV1 the matrices of the
+fit kept in 'workspace'. Saves in log10lambdaMin and log10lambdaMax the ends of
+the interval searched by the fit */
+Spline prepareGCV1(const Settings& settings,
+                   SplineWorkspace& workspace,
+                   GCV1Function& GCV1,
+                   double& log10lambdaMin,
+                   double& log10lambdaMax) {
+
+    vector<double> x, y;
+    testData(80, x, y);
+    Spline spline = fitSpline(x, y, settings, workspace);
+
+    GCV1.FiTFi = &workspace.FiTFi;
+    GCV1.R = &workspace.R;
+    GCV1.FiTy = &workspace.FiTy;
+    GCV1.FiD1 = &workspace.FiD1;
+    GCV1.estimatedD1 = &spline.data->estimatedD1;
+    GCV1.n = spline.n;
+
+    double log10lambda0 =
+        round(2.*(log10(workspace.FiTFi.norm())-log10(workspace.R.norm())))/2.;
+    log10lambdaMin = log10lambda0 - settings.lambdaSearchInterval/2.;
+    log10lambdaMax = log10lambda0 + settings.lambdaSearchInterval/2.;
+
+    return spline;
+
+}
+
+
+
+/* Checks that Brent's method, started from the coarse bracketing grid, finds
+a value of GCV1 no worse than the grid, and the same minimum as a fine grid
+within the tolerance on log10lambda */
+void testBrentAgainstGrid() {
+
+    Settings settings = testSettings();
+    SplineWorkspace workspace;
+    GCV1Function GCV1;
+    double log10lambdaMin, log10lambdaMax;
+    // The spline keeps alive the data referred to by GCV1
+    Spline spline = prepareGCV1(settings, workspace, GCV1,
+                                log10lambdaMin, log10lambdaMax);
+
+    int numberOfSteps = settings.numberOfStepsLambdaBracket;
+    double log10lambdaStep =
+        (log10lambdaMax-log10lambdaMin)/(double)(numberOfSteps-1);
+
+    GCV1Workspace GCV1workspace;
+    GCV1Minimum grid, brent;
+    minimizeGCV1OnGrid(GCV1, log10lambdaMin, log10lambdaStep, numberOfSteps,
+                       1, GCV1workspace, grid);
+    brent = grid;
+    refineGCV1WithBrent(GCV1, log10lambdaMin, log10lambdaMax, log10lambdaStep,
+                        settings.lambdaTolerance,
+                        settings.maximumLambdaEvaluations,
+                        GCV1workspace, brent);
+
+    check(brent.GCV1 <= grid.GCV1, "GCV1 of Brent no worse than the grid");
+    check(brent.numberOfEvaluations > grid.numberOfEvaluations &&
+          brent.numberOfEvaluations <=
+              grid.numberOfEvaluations + settings.maximumLambdaEvaluations,
+          "number of evaluations of Brent");
+
+    // Samples the interval bracketed by the grid with a step much smaller than
+    // the tolerance
+    double fineStep = settings.lambdaTolerance/10.;
+    double fineMin = max(log10lambdaMin, grid.log10lambda-log10lambdaStep);
+    double fineMax = min(log10lambdaMax, grid.log10lambda+log10lambdaStep);
+    GCV1Minimum fine;
+    minimizeGCV1OnGrid(GCV1, fineMin, fineStep,
+                       (int)((fineMax-fineMin)/fineStep) + 1,
+                       1, GCV1workspace, fine);
+
+    check(fabs(brent.log10lambda-fine.log10lambda) <=
+              settings.lambdaTolerance,
+          "log10lambda of Brent within the tolerance of the fine grid");
+    checkClose(brent.GCV1, fine.GCV1, 1e-6,
+               "GCV1 of Brent equal to the one of the fine grid");
+
+    // The coefficients and the trace of S are the ones of the minimum found
+    vector<double> coefficients;
+    double value = GCV1(brent.log10lambda, GCV1workspace, coefficients);
+    checkClose(brent.GCV1, value, 1e-12, "GCV1 at the minimum of Brent");
+    checkClose(brent.traceS, GCV1workspace.traceS, 1e-12,
+               "trace of S at the minimum of Brent");
+    bool sameCoefficients = coefficients == brent.coefficients;
+    check(sameCoefficients, "coefficients at the minimum of Brent");
+
+}
+
+
+
+/* Checks that the grid of lambdas, and whole fits, give exactly the same
+result with one and more threads */
+void testThreads() {
+
+    Settings settings = testSettings();
+    SplineWorkspace workspace;
+    GCV1Function GCV1;
+    double log10lambdaMin, log10lambdaMax;
+    // The spline keeps alive the data referred to by GCV1
+    Spline spline = prepareGCV1(settings, workspace, GCV1,
+                                log10lambdaMin, log10lambdaMax);
+
+    int numberOfSteps = settings.numberOfStepsLambda;
+    double log10lambdaStep =
+        (log10lambdaMax-log10lambdaMin)/(double)(numberOfSteps-1);
+
+    GCV1Workspace serialWorkspace;
+    GCV1Minimum serial;
+    minimizeGCV1OnGrid(GCV1, log10lambdaMin, log10lambdaStep, numberOfSteps,
+                       1, serialWorkspace, serial);
+
+    for (int numberOfThreads : {2, 3, 7}) {
+
+        string threads = to_string(numberOfThreads) + " threads";
+
+        GCV1Workspace parallelWorkspace;
+        GCV1Minimum parallel;
+        minimizeGCV1OnGrid(GCV1, log10lambdaMin, log10lambdaStep,
+                           numberOfSteps, numberOfThreads, parallelWorkspace,
+                           parallel);
+
+        check(parallel.log10lambda == serial.log10lambda &&
+              parallel.GCV1 == serial.GCV1 &&
+              parallel.traceS == serial.traceS &&
+              parallel.coefficients == serial.coefficients,
+              "minimum of the grid, " + threads);
+        check(parallelWorkspace.GCV1ForVariousLambdas ==
+                  serialWorkspace.GCV1ForVariousLambdas,
+              "GCV1 for each lambda, " + threads);
+
+    }
+
+    vector<double> x, y;
+    testData(120, x, y);
+    for (LambdaOptimizer lambdaOptimizer :
+         {lambdaOptimizerGrid, lambdaOptimizerBrent}) {
+
+        string optimizer = lambdaOptimizerNames[lambdaOptimizer];
+        Settings serialSettings = testSettings();
+        serialSettings.lambdaOptimizer = lambdaOptimizer;
+        Settings parallelSettings = serialSettings;
+        parallelSettings.numberOfThreadsLambda = 3;
+
+        SplineWorkspace serialFit, parallelFit;
+        Spline serialSpline = fitSpline(x, y, serialSettings, serialFit);
+        Spline parallelSpline = fitSpline(x, y, parallelSettings, parallelFit);
+
+        check(parallelSpline.traceS == serialSpline.traceS &&
+              parallelSpline.numberOfLambdaEvaluations ==
+                  serialSpline.numberOfLambdaEvaluations &&
+              parallelSpline.knots == serialSpline.knots &&
+              parallelSpline.coeffD0 == serialSpline.coeffD0,
+              "fit with 3 threads for lambda, " + optimizer);
+
+    }
+
+}
+
+
+
+int main() {
+
+    testBrentAgainstGrid();
+    testThreads();
+
+    return testResult("GCV1Test");
+
+}
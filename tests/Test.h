@@ -0,0 +1,194 @@
+/* Common part of the tests of the native core. Main.cpp is compiled together
+with each test, with its main() renamed, so that the tests can reach every
+function of the library and provide their own main() */
+
+#define main mainOfLibrary
+#include "../SplinePoliMi/Main.cpp"
+#undef main
+
+
+
+/* Number of failed checks of the test */
+int numberOfFailures = 0;
+
+
+
+/* Reports a failure if 'condition' is false */
+void check(bool condition, const string& description) {
+
+    if (!condition) {
+        ++numberOfFailures;
+        cout << "FAILED: " << description << endl;
+    }
+
+}
+
+
+
+/* Reports a failure if 'value' differs from 'expected' by more than
+'tolerance', relative to the largest between 1 and |expected| */
+void checkClose(double value,
+                double expected,
+                double tolerance,
+                const string& description) {
+
+    double error = fabs(value-expected) / max(1.,fabs(expected));
+
+    if (!(error <= tolerance)) {
+        ++numberOfFailures;
+        cout << "FAILED: " << description << setprecision(17)
+             << " (value " << value << ", expected " << expected << ")"
+             << endl;
+    }
+
+}
+
+
+
+/* Prints the outcome of the test, and returns its exit status */
+int testResult(const string& name) {
+
+    if (numberOfFailures == 0)
+        cout << name << ": all checks passed" << endl;
+    else
+        cout << name << ": " << numberOfFailures << " checks failed" << endl;
+
+    return numberOfFailures == 0 ? 0 : 1;
+
+}
+
+
+
+/* Solves A*x = b by Gaussian elimination with partial pivoting in long
+double, as a reference for the solvers of the library */
+vector<double> solveDense(vector<vector<long double>> A,
+                          vector<long double> b) {
+
+    int K = A.size();
+
+    for (int j=0; j<K; ++j) {
+        int pivot = j;
+        for (int i=j+1; i<K; ++i)
+            if (fabsl(A[i][j]) > fabsl(A[pivot][j]))
+                pivot = i;
+        swap(A[j], A[pivot]);
+        swap(b[j], b[pivot]);
+        for (int i=j+1; i<K; ++i) {
+            long double factor = A[i][j] / A[j][j];
+            for (int k=j; k<K; ++k)
+                A[i][k] -= factor * A[j][k];
+            b[i] -= factor * b[j];
+        }
+    }
+
+    vector<double> x(K);
+    for (int i=K-1; i>=0; --i) {
+        long double sum = b[i];
+        for (int k=i+1; k<K; ++k)
+            sum -= A[i][k] * (long double)x[k];
+        x[i] = (double)(sum / A[i][i]);
+    }
+
+    return x;
+
+}
+
+
+
+/* Returns the band matrix as a dense one, including the elements above the
+main diagonal */
+vector<vector<long double>> denseMatrix(const BandMatrix& M) {
+
+    vector<vector<long double>> A(M.K, vector<long double>(M.K, 0));
+    for (int i=0; i<M.K; ++i)
+        for (int j=max(0,i-M.bandwidth); j<=min(M.K-1,i+M.bandwidth); ++j)
+            A[i][j] = M(i,j);
+
+    return A;
+
+}
+
+
+
+/* Fills the band of M with a random symmetric positive definite matrix, its
+main diagonal dominating the sum of the other elements of each row */
+void randomPositiveDefinite(BandMatrix& M, mt19937& generator) {
+
+    uniform_real_distribution<double> distribution(-1., 1.);
+
+    for (int i=0; i<M.K; ++i)
+        for (int j=max(0,i-M.bandwidth); j<i; ++j)
+            M(i,j) = distribution(generator);
+    for (int i=0; i<M.K; ++i) {
+        double sum = 0;
+        for (int j=max(0,i-M.bandwidth); j<=min(M.K-1,i+M.bandwidth); ++j)
+            if (j != i)
+                sum += fabs(M(i,j));
+        M(i,i) = sum + 0.5 + fabs(distribution(generator));
+    }
+
+}
+
+
+
+/* Returns the default settings of the library for splines of the given
+degree */
+Settings testSettings(int degree = 3) {
+
+    Settings settings;
+    settings.setDegree(degree);
+
+    return settings;
+
+}
+
+
+
+/* Generates n points of a smooth curve with a deterministic, noise-like
+perturbation, on abscissae from 0 to 10 */
+void testData(int n, vector<double>& x, vector<double>& y) {
+
+    x.resize(n);
+    y.resize(n);
+    for (int i=0; i<n; ++i) {
+        x[i] = 10. * i / (n-1);
+        y[i] = 1. + sin(x[i]) * exp(-0.1*x[i]) + 0.02 * sin(97.*i*i);
+    }
+
+}
+
+
+
+/* Fits a spline to the data with the given settings and number of abscissae
+between consecutive knots, keeping the temporaries in 'workspace' */
+Spline fitSpline(const vector<double>& x,
+                 const vector<double>& y,
+                 const Settings& settings,
+                 SplineWorkspace& workspace,
+                 int numberOfAbscissaeSeparatingConsecutiveKnots = 2) {
+
+    auto data = make_shared<SplineData>();
+    data->prepare(x, y, 0);
+
+    Spline spline;
+    spline.solve(data, numberOfAbscissaeSeparatingConsecutiveKnots, settings,
+                 workspace);
+
+    return spline;
+
+}
+
+
+
+/* Returns the polynomials of the spline one after the other, 'stride'
+coefficients each, as passed to the C functions by compute_spline_cpp */
+vector<double> flatCoefficients(const vector<vector<double>>& polynomials,
+                                int stride) {
+
+    vector<double> flat(polynomials.size()*stride, 0);
+    for (int i=0; i<(int)polynomials.size(); ++i)
+        copy(polynomials[i].begin(), polynomials[i].end(), &flat[i*stride]);
+
+    return flat;
+
+}
@@ -0,0 +1,72 @@
+/* Tests of the thread pool shared by the lambda search, the candidate splines
+and the batch of curves */
+
+#include "Test.h"
+
+
+
+/* Checks that every task is run exactly once, with one and more threads */
+void testAllTasksRun() {
+
+    for (int numberOfThreads : {1, 3}) {
+
+        ThreadPool pool(numberOfThreads);
+        vector<atomic<int>> calls(100);
+        for (auto& c : calls)
+            c = 0;
+
+        // Runs the pool twice, so that the second run reuses the job
+        for (int run=0; run<2; ++run)
+            pool.run(calls.size(), [&](int i) { ++calls[i]; });
+
+        bool allTwice = true;
+        for (auto& c : calls)
+            allTwice = allTwice && c == 2;
+        check(allTwice, "each task run once per call, " +
+                        to_string(numberOfThreads) + " threads");
+
+    }
+
+}
+
+
+
+/* Checks that an exception thrown by a task is rethrown by run(), and that
+the pool still works afterwards */
+void testExceptions() {
+
+    for (int numberOfThreads : {1, 3}) {
+
+        string threads = to_string(numberOfThreads) + " threads";
+        ThreadPool pool(numberOfThreads);
+
+        string message;
+        try {
+            pool.run(50, [](int i) {
+                if (i == 7)
+                    throw runtime_error("task 7");
+            });
+        }
+        catch (const runtime_error& error) {
+            message = error.what();
+        }
+        check(message == "task 7", "exception rethrown by run(), " + threads);
+
+        atomic<int> completed(0);
+        pool.run(50, [&](int) { ++completed; });
+        check(completed == 50, "tasks run after an exception, " + threads);
+
+    }
+
+}
+
+
+
+int main() {
+
+    testAllTasksRun();
+    testExceptions();
+
+    return testResult("ThreadPoolTest");
+
+}
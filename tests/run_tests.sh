@@ -0,0 +1,20 @@
+#!/bin/bash
+# Compiles each test of the native core together with the library, with the
+# flags used by setup.py, and runs it. Exits with 1 if any test fails
+cd "$(dirname "$0")/.."
+
+buildDirectory=$(mktemp -d)
+trap 'rm -rf "$buildDirectory"' EXIT
+
+status=0
+for test in tests/*Test.cpp; do
+    executable="$buildDirectory/$(basename "$test" .cpp)"
+    if ! g++ -std=c++17 "$test" -o "$executable" -O3 -Wall -DNDEBUG -pthread; then
+        echo "$test: compilation failed"
+        status=1
+        continue
+    fi
+    "$executable" || status=1
+done
+
+exit $status